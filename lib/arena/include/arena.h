@@ -0,0 +1,17 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include "utils.h"
+
+// Every allocation is aligned to this, one cache line
+#define ARENA_ALIGN 64
+
+typedef struct arena Arena;
+
+Arena* arena_create     (const u64);
+void*  arena_alloc      (Arena*, const u64);
+void   arena_reset      (Arena*);
+u64    arena_high_water (const Arena*);
+void   arena_free       (Arena*);
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,96 @@
+#include "arena.h"
+
+// Allocations past the main block land in chunks until the next reset
+struct arena_chunk {
+  struct arena_chunk* next;
+};
+
+struct arena {
+  u8* base;
+  u64 capacity, used;
+  struct arena_chunk* chunks;
+  u64 s_chunks;   // Bytes handed out from chunks
+  u64 high_water; // Most bytes live between two resets
+};
+
+static u64 align_up(const u64 size) {
+  return (size + ARENA_ALIGN - 1) & ~(u64)(ARENA_ALIGN - 1);
+}
+
+Arena* arena_create(const u64 capacity) {
+  assert(capacity > 0);
+
+  Arena* arena = (Arena*)malloc(sizeof(struct arena));
+  assert(arena != NULL);
+
+  u8* base = (u8*)aligned_alloc(ARENA_ALIGN, align_up(capacity));
+  assert(base != NULL);
+
+  *arena = (Arena){
+    .base       = base,
+    .capacity   = align_up(capacity),
+    .used       = 0,
+    .chunks     = NULL,
+    .s_chunks   = 0,
+    .high_water = 0
+  };
+
+  return arena;
+}
+
+void* arena_alloc(Arena* arena, const u64 size) {
+  const u64 s_aligned = align_up(size);
+
+  void* data;
+  if (arena->used + s_aligned <= arena->capacity) {
+    data = arena->base + arena->used;
+    arena->used += s_aligned;
+  } else {
+    // The header takes a whole line so the data stays aligned
+    struct arena_chunk* chunk = (struct arena_chunk*)aligned_alloc(ARENA_ALIGN, ARENA_ALIGN + s_aligned);
+    assert(chunk != NULL);
+
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->s_chunks += s_aligned;
+    data = (u8*)chunk + ARENA_ALIGN;
+  }
+
+  if (arena->high_water < arena->used + arena->s_chunks)
+    arena->high_water = arena->used + arena->s_chunks;
+
+  return data;
+}
+
+// O(1) in steady state. After a frame that overflowed, the chunks are
+// released and the main block regrown to the high-water mark, once.
+void arena_reset(Arena* arena) {
+  if (arena->chunks != NULL) {
+    while (arena->chunks != NULL) {
+      struct arena_chunk* next = arena->chunks->next;
+      free(arena->chunks);
+      arena->chunks = next;
+    }
+    arena->s_chunks = 0;
+
+    free(arena->base);
+    arena->capacity = align_up(arena->high_water + arena->high_water / 2);
+    arena->base = (u8*)aligned_alloc(ARENA_ALIGN, arena->capacity);
+    assert(arena->base != NULL);
+  }
+
+  arena->used = 0;
+}
+
+u64 arena_high_water(const Arena* arena) {
+  return arena->high_water;
+}
+
+void arena_free(Arena* arena) {
+  if (arena == NULL)
+    return;
+
+  arena_reset(arena);
+  free(arena->base);
+  free(arena);
+}
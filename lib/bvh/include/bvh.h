@@ -0,0 +1,43 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include "utils.h"
+#include "geometry.h"
+#include "graphics.h"
+#include "model.h"
+
+// Bounding volume hierarchy over placed models, tested against the view
+// frustum before any of their vertices is transformed. An item is a model
+// with a placement matrix and a tint, boxed by the model's bounds carried
+// through the placement; a NULL model draws nothing.
+//
+//   const u32 item = bvh_insert(bvh, model, &placement, ColorWhite);
+//   bvh_move(bvh, item, &moved);
+//   bvh_clip(bvh, &view_projection, queue);
+//
+// Inserting rebuilds the tree on the next bvh_clip. Moving an item or
+// swapping its model only refits the boxes on its path to the root.
+//
+// Items marked with bvh_set_occluder, large opaque models like walls and
+// buildings, are first rasterized into a small depth buffer, and boxes
+// entirely behind it are dropped with everything below them.
+typedef struct bvh Bvh;
+
+// Items through bvh_clip since the BVH was created
+typedef struct bvh_stats {
+  u64 clipped;  // Handed to the clipper
+  u64 culled;   // Outside the frustum
+  u64 occluded; // Behind the occluders
+} BvhStats;
+
+Bvh*     bvh_create           (const u32);
+u32      bvh_insert           (Bvh*, const Model*, const Mat4*, const Color);
+void     bvh_insert_instances (Bvh*, const Model*, const Instances*);
+void     bvh_set_model        (Bvh*, const u32, const Model*);
+void     bvh_move             (Bvh*, const u32, const Mat4*);
+void     bvh_set_occluder     (Bvh*, const u32, const bool);
+void     bvh_clip             (Bvh*, const Mat4*, RenderQueueSoA*);
+BvhStats bvh_stats            (const Bvh*);
+void     bvh_free             (Bvh*);
+
+#endif /* __BVH_H__ */
@@ -0,0 +1,612 @@
+#include "bvh.h"
+#include "profile.h"
+
+// Items a node may hold before it is split
+#define BVH_LEAF_ITEMS 4
+// Marks the root's parent
+#define BVH_NONE UINT32_MAX
+
+// Occluders are rasterized at this size whatever the screen's, so a pixel
+// spans a few screen tiles
+#define BVH_OCCLUSION_WIDTH  256
+#define BVH_OCCLUSION_HEIGHT 144
+// Initial capacity of the occluder triangle queue, grown in the frame arena
+#define BVH_OCCLUDER_TRIANGLES 1024
+
+// Frustum planes in clip space, kept where a * x + b * y + c * z + d * w >= 0.
+// The projection is infinite, so there is no far plane.
+enum bvh_planes {
+  BvhNear, BvhLeft, BvhRight, BvhTop, BvhBottom,
+  BvhPlanes
+};
+
+// Planes a box still has to be tested against, as bits
+#define BVH_ALL_PLANES ((1u << BvhPlanes) - 1)
+
+static const f32 bvh_planes[BvhPlanes][4] = {
+  [BvhNear]   = {  0.0f,  0.0f, -1.0f, 1.0f },
+  [BvhLeft]   = {  1.0f,  0.0f,  0.0f, 1.0f },
+  [BvhRight]  = { -1.0f,  0.0f,  0.0f, 1.0f },
+  [BvhTop]    = {  0.0f, -1.0f,  0.0f, 1.0f },
+  [BvhBottom] = {  0.0f,  1.0f,  0.0f, 1.0f }
+};
+
+struct bvh_box {
+  f32 min[3], max[3];
+};
+
+struct bvh_item {
+  const Model* model;
+  Mat4 placement;
+  Color tint;
+  struct bvh_box box; // World space
+  bool occluder;
+};
+
+// Children of an inner node are adjacent, and every node's items are a
+// contiguous range of order
+struct bvh_node {
+  struct bvh_box box;
+  u32 parent;
+  u32 child;          // First of two children, 0 for leaves
+  u32 first, s_items; // Range of order
+};
+
+struct bvh {
+  u32 s_items, c_items;
+  struct bvh_item* items;
+  u32* order;
+  u32* leaf;          // Leaf holding each item
+
+  u32 s_nodes;        // At most 2 * c_items - 1
+  struct bvh_node* nodes;
+  bool stale;         // Items were inserted since the last build
+
+  u32 s_occluders;
+  u32* occluders;     // Items, c_items of them allocated
+  // Per pixel, 1 / w of the farthest point of the nearest occluder covering
+  // the whole pixel, 0 where none does. Allocated with the first occluder.
+  f32* occlusion;
+
+  BvhStats stats;
+};
+
+// State of one bvh_clip
+struct bvh_view {
+  f32 planes[BvhPlanes][4]; // World space
+  Mat4 view_projection;
+  RenderQueueSoA* queue;
+  const f32* occlusion;     // NULL when no occluder is in view
+  BvhStats stats;
+};
+
+static const struct bvh_box bvh_empty = {
+  .min = {  INFINITY,  INFINITY,  INFINITY },
+  .max = { -INFINITY, -INFINITY, -INFINITY }
+};
+
+static void bvh_item_box(struct bvh_item*);
+static void bvh_box_merge(struct bvh_box*, const struct bvh_box*);
+static bool bvh_box_equal(const struct bvh_box*, const struct bvh_box*);
+static void bvh_build(Bvh*);
+static void bvh_split(Bvh*, const u32);
+static void bvh_refit(Bvh*, u32);
+static void bvh_visit(const Bvh*, struct bvh_view*, const u32, u32);
+static u32  bvh_classify(const struct bvh_box*, const f32[BvhPlanes][4], const u32);
+static void bvh_occlusion(Bvh*, struct bvh_view*);
+static void bvh_occlusion_triangle(f32*, const f32[3], const f32[3], const f32[3]);
+static bool bvh_occluded(const struct bvh_view*, const struct bvh_box*);
+
+Bvh* bvh_create(const u32 capacity) {
+  const u32 c_items = capacity > 0 ? capacity : 1;
+
+  Bvh* bvh = (Bvh*)malloc(sizeof(struct bvh));
+  assert(bvh != NULL);
+
+  *bvh = (Bvh){
+    .s_items = 0,
+    .c_items = c_items,
+    .items   = (struct bvh_item*)malloc(c_items * sizeof(struct bvh_item)),
+    .order   = (u32*)malloc(c_items * sizeof(u32)),
+    .leaf    = (u32*)malloc(c_items * sizeof(u32)),
+    .s_nodes = 0,
+    .nodes   = (struct bvh_node*)malloc(2 * c_items * sizeof(struct bvh_node)),
+    .stale   = true,
+    .s_occluders = 0,
+    .occluders   = (u32*)malloc(c_items * sizeof(u32)),
+    .occlusion   = NULL,
+    .stats       = { 0 }
+  };
+  assert(bvh->items != NULL && bvh->order != NULL && bvh->leaf != NULL && bvh->nodes != NULL);
+  assert(bvh->occluders != NULL);
+
+  return bvh;
+}
+
+u32 bvh_insert(Bvh* bvh, const Model* model, const Mat4* placement, const Color tint) {
+  if (bvh->s_items == bvh->c_items) {
+    bvh->c_items *= 2;
+    bvh->items = (struct bvh_item*)realloc(bvh->items, bvh->c_items * sizeof(struct bvh_item));
+    bvh->order = (u32*)realloc(bvh->order, bvh->c_items * sizeof(u32));
+    bvh->leaf  = (u32*)realloc(bvh->leaf, bvh->c_items * sizeof(u32));
+    bvh->nodes = (struct bvh_node*)realloc(bvh->nodes, 2 * bvh->c_items * sizeof(struct bvh_node));
+    bvh->occluders = (u32*)realloc(bvh->occluders, bvh->c_items * sizeof(u32));
+    assert(bvh->items != NULL && bvh->order != NULL && bvh->leaf != NULL && bvh->nodes != NULL);
+    assert(bvh->occluders != NULL);
+  }
+
+  const u32 item = bvh->s_items++;
+  bvh->items[item] = (struct bvh_item){
+    .model     = model,
+    .placement = *placement,
+    .tint      = tint,
+    .occluder  = false
+  };
+  bvh_item_box(&bvh->items[item]);
+  bvh->stale = true;
+
+  return item;
+}
+
+void bvh_insert_instances(Bvh* bvh, const Model* model, const Instances* instances) {
+  for (u32 i = 0; i < instances->count; i++) {
+    const Mat4 placement = geometry_mat4_model(
+      (Vec3D){ instances->px[i], instances->py[i], instances->pz[i] },
+      (Vec3D){ instances->rx[i], instances->ry[i], instances->rz[i] },
+      (Vec3D){ instances->ux[i], instances->uy[i], instances->uz[i] },
+      (Vec3D){ instances->fx[i], instances->fy[i], instances->fz[i] },
+      instances->scale[i]
+    );
+    bvh_insert(bvh, model, &placement, (Color){ instances->r[i], instances->g[i], instances->b[i] });
+  }
+}
+
+void bvh_set_model(Bvh* bvh, const u32 item, const Model* model) {
+  assert(item < bvh->s_items);
+
+  bvh->items[item].model = model;
+  bvh_item_box(&bvh->items[item]);
+  if (!bvh->stale)
+    bvh_refit(bvh, bvh->leaf[item]);
+}
+
+void bvh_move(Bvh* bvh, const u32 item, const Mat4* placement) {
+  assert(item < bvh->s_items);
+
+  bvh->items[item].placement = *placement;
+  bvh_item_box(&bvh->items[item]);
+  if (!bvh->stale)
+    bvh_refit(bvh, bvh->leaf[item]);
+}
+
+void bvh_set_occluder(Bvh* bvh, const u32 item, const bool occluder) {
+  assert(item < bvh->s_items);
+  if (bvh->items[item].occluder == occluder)
+    return;
+
+  bvh->items[item].occluder = occluder;
+  if (occluder) {
+    bvh->occluders[bvh->s_occluders++] = item;
+    if (bvh->occlusion == NULL) {
+      bvh->occlusion = (f32*)malloc(BVH_OCCLUSION_WIDTH * BVH_OCCLUSION_HEIGHT * sizeof(f32));
+      assert(bvh->occlusion != NULL);
+    }
+    return;
+  }
+
+  for (u32 i = 0; i < bvh->s_occluders; i++)
+    if (bvh->occluders[i] == item) {
+      bvh->occluders[i] = bvh->occluders[--bvh->s_occluders];
+      break;
+    }
+}
+
+// Clips the items whose boxes may be in view. A box entirely inside a plane
+// is not tested against it again below, so most nodes in the middle of the
+// view test no plane at all.
+void bvh_clip(Bvh* bvh, const Mat4* view_projection, RenderQueueSoA* queue) {
+  if (bvh->s_items == 0)
+    return;
+  if (bvh->stale)
+    bvh_build(bvh);
+
+  struct bvh_view view = {
+    .view_projection = *view_projection,
+    .queue           = queue,
+    .occlusion       = NULL,
+    .stats           = { 0 }
+  };
+
+  // Each clip space plane pulled back through view_projection is a plane
+  // in world space
+  for (u32 p = 0; p < BvhPlanes; p++)
+    for (u32 c = 0; c < 4; c++)
+      view.planes[p][c] =
+        bvh_planes[p][0] * view_projection->m[0][c] +
+        bvh_planes[p][1] * view_projection->m[1][c] +
+        bvh_planes[p][2] * view_projection->m[2][c] +
+        bvh_planes[p][3] * view_projection->m[3][c];
+
+  if (bvh->s_occluders > 0) {
+    PROFILE_ZONE_BEGIN("bvh_occlusion");
+    bvh_occlusion(bvh, &view);
+    PROFILE_ZONE_END("bvh_occlusion");
+  }
+
+  bvh_visit(bvh, &view, 0, BVH_ALL_PLANES);
+
+  bvh->stats.clipped  += view.stats.clipped;
+  bvh->stats.culled   += view.stats.culled;
+  bvh->stats.occluded += view.stats.occluded;
+}
+
+BvhStats bvh_stats(const Bvh* bvh) {
+  return bvh->stats;
+}
+
+void bvh_free(Bvh* bvh) {
+  if (bvh == NULL)
+    return;
+
+  free(bvh->items);
+  free(bvh->order);
+  free(bvh->leaf);
+  free(bvh->nodes);
+  free(bvh->occluders);
+  free(bvh->occlusion);
+  free(bvh);
+}
+
+// The model's box through the placement, per row the extremes of each term
+static void bvh_item_box(struct bvh_item* item) {
+  if (item->model == NULL) {
+    item->box = bvh_empty;
+    return;
+  }
+
+  const f32
+    lo[3] = { item->model->min.x, item->model->min.y, item->model->min.z },
+    hi[3] = { item->model->max.x, item->model->max.y, item->model->max.z };
+  for (u32 r = 0; r < 3; r++) {
+    f32
+      min = item->placement.m[r][3],
+      max = item->placement.m[r][3];
+    for (u32 c = 0; c < 3; c++) {
+      const f32
+        a = item->placement.m[r][c] * lo[c],
+        b = item->placement.m[r][c] * hi[c];
+      min += fminf(a, b);
+      max += fmaxf(a, b);
+    }
+    item->box.min[r] = min;
+    item->box.max[r] = max;
+  }
+}
+
+static void bvh_box_merge(struct bvh_box* box, const struct bvh_box* other) {
+  for (u32 a = 0; a < 3; a++) {
+    box->min[a] = fminf(box->min[a], other->min[a]);
+    box->max[a] = fmaxf(box->max[a], other->max[a]);
+  }
+}
+
+static bool bvh_box_equal(const struct bvh_box* a, const struct bvh_box* b) {
+  for (u32 i = 0; i < 3; i++)
+    if (a->min[i] != b->min[i] || a->max[i] != b->max[i])
+      return false;
+  return true;
+}
+
+static void bvh_build(Bvh* bvh) {
+  for (u32 i = 0; i < bvh->s_items; i++)
+    bvh->order[i] = i;
+
+  bvh->nodes[0] = (struct bvh_node){
+    .parent  = BVH_NONE,
+    .child   = 0,
+    .first   = 0,
+    .s_items = bvh->s_items
+  };
+  bvh->s_nodes = 1;
+  bvh_split(bvh, 0);
+  bvh->stale = false;
+}
+
+// Splits the node's items at the middle of their centers along the longest
+// axis, or in halves when they all fall on one side
+static void bvh_split(Bvh* bvh, const u32 n) {
+  const u32
+    first   = bvh->nodes[n].first,
+    s_items = bvh->nodes[n].s_items;
+  u32* order = bvh->order + first;
+
+  if (s_items <= BVH_LEAF_ITEMS) {
+    struct bvh_box box = bvh_empty;
+    for (u32 i = 0; i < s_items; i++) {
+      bvh_box_merge(&box, &bvh->items[order[i]].box);
+      bvh->leaf[order[i]] = n;
+    }
+    bvh->nodes[n].box = box;
+    return;
+  }
+
+  // Empty boxes have no center and always land on the right
+  struct bvh_box centers = bvh_empty;
+  for (u32 i = 0; i < s_items; i++) {
+    const struct bvh_box* box = &bvh->items[order[i]].box;
+    for (u32 a = 0; a < 3; a++) {
+      const f32 center = (box->min[a] + box->max[a]) / 2.0f;
+      centers.min[a] = fminf(centers.min[a], center);
+      centers.max[a] = fmaxf(centers.max[a], center);
+    }
+  }
+
+  u32 axis = 0;
+  for (u32 a = 1; a < 3; a++)
+    if (centers.max[a] - centers.min[a] > centers.max[axis] - centers.min[axis])
+      axis = a;
+  const f32 middle = (centers.min[axis] + centers.max[axis]) / 2.0f;
+
+  u32 split = 0;
+  for (u32 i = 0; i < s_items; i++) {
+    const struct bvh_box* box = &bvh->items[order[i]].box;
+    if ((box->min[axis] + box->max[axis]) / 2.0f < middle) {
+      const u32 t = order[i]; order[i] = order[split]; order[split] = t;
+      split++;
+    }
+  }
+  if (split == 0 || split == s_items)
+    split = s_items / 2;
+
+  const u32 child = bvh->s_nodes;
+  bvh->s_nodes += 2;
+  bvh->nodes[child] = (struct bvh_node){
+    .parent = n, .child = 0, .first = first, .s_items = split
+  };
+  bvh->nodes[child + 1] = (struct bvh_node){
+    .parent = n, .child = 0, .first = first + split, .s_items = s_items - split
+  };
+  bvh->nodes[n].child = child;
+
+  bvh_split(bvh, child);
+  bvh_split(bvh, child + 1);
+
+  struct bvh_box box = bvh->nodes[child].box;
+  bvh_box_merge(&box, &bvh->nodes[child + 1].box);
+  bvh->nodes[n].box = box;
+}
+
+// Rebounds the node and its ancestors, up to the first whose box holds
+static void bvh_refit(Bvh* bvh, u32 n) {
+  for (; n != BVH_NONE; n = bvh->nodes[n].parent) {
+    struct bvh_node* node = &bvh->nodes[n];
+    struct bvh_box box = bvh_empty;
+    if (node->child == 0)
+      for (u32 i = 0; i < node->s_items; i++)
+        bvh_box_merge(&box, &bvh->items[bvh->order[node->first + i]].box);
+    else {
+      bvh_box_merge(&box, &bvh->nodes[node->child].box);
+      bvh_box_merge(&box, &bvh->nodes[node->child + 1].box);
+    }
+
+    if (bvh_box_equal(&box, &node->box))
+      return;
+    node->box = box;
+  }
+}
+
+static void bvh_visit(const Bvh* bvh, struct bvh_view* view, const u32 n, u32 mask) {
+  const struct bvh_node* node = &bvh->nodes[n];
+  mask = bvh_classify(&node->box, (const f32(*)[4])view->planes, mask);
+  if (mask == UINT32_MAX) {
+    PROFILE_COUNT(ProfileModelsCulled, node->s_items);
+    view->stats.culled += node->s_items;
+    return;
+  }
+  if (bvh_occluded(view, &node->box)) {
+    PROFILE_COUNT(ProfileModelsOccluded, node->s_items);
+    view->stats.occluded += node->s_items;
+    return;
+  }
+
+  if (node->child != 0) {
+    bvh_visit(bvh, view, node->child, mask);
+    bvh_visit(bvh, view, node->child + 1, mask);
+    return;
+  }
+
+  for (u32 i = 0; i < node->s_items; i++) {
+    const struct bvh_item* item = &bvh->items[bvh->order[node->first + i]];
+    if (item->model == NULL)
+      continue;
+    if (node->s_items > 1) {
+      if (bvh_classify(&item->box, (const f32(*)[4])view->planes, mask) == UINT32_MAX) {
+        PROFILE_COUNT(ProfileModelsCulled, 1);
+        view->stats.culled++;
+        continue;
+      }
+      if (bvh_occluded(view, &item->box)) {
+        PROFILE_COUNT(ProfileModelsOccluded, 1);
+        view->stats.occluded++;
+        continue;
+      }
+    }
+
+    const Mat4 mvp = geometry_mat4_mul(&view->view_projection, &item->placement);
+    graphics_clipper_tinted(&mvp, item->model, item->tint, view->queue);
+    view->stats.clipped++;
+  }
+}
+
+// Planes of mask the box still straddles, or UINT32_MAX when it is entirely
+// outside one of them
+static u32 bvh_classify(const struct bvh_box* box, const f32 planes[BvhPlanes][4], const u32 mask) {
+  if (box->min[0] > box->max[0])
+    return UINT32_MAX;
+
+  u32 straddled = 0;
+  for (u32 p = 0; p < BvhPlanes; p++) {
+    if (!(mask & (1u << p)))
+      continue;
+
+    // Distances of the corners furthest along and against the normal
+    f32
+      far  = planes[p][3],
+      near = planes[p][3];
+    for (u32 a = 0; a < 3; a++) {
+      const f32 n = planes[p][a];
+      far  += n * (n >= 0 ? box->max[a] : box->min[a]);
+      near += n * (n >= 0 ? box->min[a] : box->max[a]);
+    }
+
+    if (far < 0)
+      return UINT32_MAX;
+    if (near < 0)
+      straddled |= 1u << p;
+  }
+  return straddled;
+}
+
+// Clips the occluders in view into a scratch queue in the frame arena, the
+// same path anything drawn takes, and rasterizes it into the occlusion buffer
+static void bvh_occlusion(Bvh* bvh, struct bvh_view* view) {
+  RenderQueueSoA occluders = { .capacity = BVH_OCCLUDER_TRIANGLES, .arena = view->queue->arena };
+  graphics_queue_reset(&occluders);
+
+  for (u32 i = 0; i < bvh->s_occluders; i++) {
+    const struct bvh_item* item = &bvh->items[bvh->occluders[i]];
+    if (item->model == NULL ||
+        bvh_classify(&item->box, (const f32(*)[4])view->planes, BVH_ALL_PLANES) == UINT32_MAX)
+      continue;
+
+    const Mat4 mvp = geometry_mat4_mul(&view->view_projection, &item->placement);
+    graphics_clipper_tinted(&mvp, item->model, item->tint, &occluders);
+  }
+  if (occluders.count == 0)
+    return;
+
+  memset(bvh->occlusion, 0, BVH_OCCLUSION_WIDTH * BVH_OCCLUSION_HEIGHT * sizeof(f32));
+  for (u32 t = 0; t < occluders.count; t++)
+    bvh_occlusion_triangle(
+      bvh->occlusion,
+      (const f32[3]){ occluders.v1x[t], occluders.v2x[t], occluders.v3x[t] },
+      (const f32[3]){ occluders.v1y[t], occluders.v2y[t], occluders.v3y[t] },
+      (const f32[3]){ occluders.v1w[t], occluders.v2w[t], occluders.v3w[t] }
+    );
+  view->occlusion = bvh->occlusion;
+}
+
+// Conservative in both senses: only pixels the triangle covers entirely are
+// written, with the least 1 / w the triangle takes over them
+static void bvh_occlusion_triangle(f32* occlusion, const f32 x[3], const f32 y[3], const f32 w[3]) {
+  const f32
+    half_width  = BVH_OCCLUSION_WIDTH / 2.0f,
+    half_height = BVH_OCCLUSION_HEIGHT / 2.0f;
+
+  f32 sx[3], sy[3], d[3];
+  for (u32 i = 0; i < 3; i++) {
+    d[i]  = 1.0f / w[i];
+    sx[i] =  x[i] * d[i] * half_width + half_width;
+    sy[i] = -y[i] * d[i] * half_height + half_height;
+  }
+
+  const f32 area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+  if (!(fabsf(area) > 0.0f))
+    return;
+
+  // Edge i is opposite vertex i, positive inside
+  f32 ea[3], eb[3], ec[3];
+  for (u32 i = 0; i < 3; i++) {
+    const u32
+      a = (i + 1) % 3,
+      b = (i + 2) % 3;
+    const f32 sign = area > 0 ? 1.0f : -1.0f;
+    ea[i] = sign * (sy[a] - sy[b]);
+    eb[i] = sign * (sx[b] - sx[a]);
+    ec[i] = -(ea[i] * sx[a] + eb[i] * sy[a]);
+  }
+
+  const f32
+    ddx = ((d[1] - d[0]) * (sy[2] - sy[0]) - (d[2] - d[0]) * (sy[1] - sy[0])) / area,
+    ddy = ((d[2] - d[0]) * (sx[1] - sx[0]) - (d[1] - d[0]) * (sx[2] - sx[0])) / area,
+    dc  = d[0] - ddx * sx[0] - ddy * sy[0],
+    d_min = fminf(d[0], fminf(d[1], d[2]));
+
+  // Pixels whose whole square lies within the bounds
+  const f32
+    min_x = fminf(sx[0], fminf(sx[1], sx[2])), max_x = fmaxf(sx[0], fmaxf(sx[1], sx[2])),
+    min_y = fminf(sy[0], fminf(sy[1], sy[2])), max_y = fmaxf(sy[0], fmaxf(sy[1], sy[2]));
+  const i32
+    x0 = (i32)fmaxf(ceilf(min_x), 0.0f),
+    y0 = (i32)fmaxf(ceilf(min_y), 0.0f),
+    x1 = (i32)fminf(floorf(max_x), BVH_OCCLUSION_WIDTH) - 1,
+    y1 = (i32)fminf(floorf(max_y), BVH_OCCLUSION_HEIGHT) - 1;
+
+  for (i32 py = y0; py <= y1; py++) {
+    f32* row = occlusion + py * BVH_OCCLUSION_WIDTH;
+    for (i32 px = x0; px <= x1; px++) {
+      // Each edge and the depth at the pixel corner where they are least
+      bool covered = true;
+      for (u32 i = 0; i < 3 && covered; i++)
+        covered = ea[i] * px + eb[i] * py + ec[i] + fminf(ea[i], 0.0f) + fminf(eb[i], 0.0f) >= 0.0f;
+      if (!covered)
+        continue;
+
+      const f32 depth = fmaxf(dc + ddx * px + ddy * py + fminf(ddx, 0.0f) + fminf(ddy, 0.0f), d_min);
+      if (row[px] < depth)
+        row[px] = depth;
+    }
+  }
+}
+
+// Whether every pixel the box's projection touches has an occluder nearer
+// than the nearest point of the box. Boxes reaching behind the near plane
+// are never occluded.
+static bool bvh_occluded(const struct bvh_view* view, const struct bvh_box* box) {
+  if (view->occlusion == NULL)
+    return false;
+
+  const f32 (*m)[4] = view->view_projection.m;
+  f32
+    min_x = INFINITY, max_x = -INFINITY,
+    min_y = INFINITY, max_y = -INFINITY,
+    near  = 0.0f;
+  for (u32 k = 0; k < 8; k++) {
+    const f32 p[3] = {
+      k & 1 ? box->max[0] : box->min[0],
+      k & 2 ? box->max[1] : box->min[1],
+      k & 4 ? box->max[2] : box->min[2]
+    };
+    const f32
+      x = m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3],
+      y = m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3],
+      z = m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3],
+      w = m[3][0] * p[0] + m[3][1] * p[1] + m[3][2] * p[2] + m[3][3];
+    if (!(w >= z))
+      return false;
+
+    const f32
+      inv = 1.0f / w,
+      sx =  x * inv * (BVH_OCCLUSION_WIDTH / 2.0f) + BVH_OCCLUSION_WIDTH / 2.0f,
+      sy = -y * inv * (BVH_OCCLUSION_HEIGHT / 2.0f) + BVH_OCCLUSION_HEIGHT / 2.0f;
+    min_x = fminf(min_x, sx); max_x = fmaxf(max_x, sx);
+    min_y = fminf(min_y, sy); max_y = fmaxf(max_y, sy);
+    near  = fmaxf(near, inv);
+  }
+
+  const i32
+    x0 = (i32)fmaxf(floorf(min_x), 0.0f),
+    y0 = (i32)fmaxf(floorf(min_y), 0.0f),
+    x1 = (i32)fminf(floorf(max_x), BVH_OCCLUSION_WIDTH - 1),
+    y1 = (i32)fminf(floorf(max_y), BVH_OCCLUSION_HEIGHT - 1);
+  if (x0 > x1 || y0 > y1)
+    return false;
+
+  for (i32 py = y0; py <= y1; py++) {
+    const f32* row = view->occlusion + py * BVH_OCCLUSION_WIDTH;
+    for (i32 px = x0; px <= x1; px++)
+      if (!(row[px] > near))
+        return false;
+  }
+  return true;
+}
@@ -35,12 +35,37 @@ typedef struct camera {
   f32
     pitch,
     yaw,
-    fov
+    fov,
     near_plane;
 } Camera;
 
-f32   geometry_camera_horizon   (const Camera*, const f32);
-Vec3D geometry_camera_transform (const Camera*, const Vec3D);
+// Camera rotation with its trigonometry resolved, built once per frame
+typedef struct camera_view {
+  Vec3D position;
+  f32
+    cos_pitch, sin_pitch,
+    cos_yaw,   sin_yaw;
+} CameraView;
+
+// Row-major, applied to column vectors: out[r] = m[r][0] * x + m[r][1] * y + m[r][2] * z + m[r][3] * w
+typedef struct mat4 {
+  f32 m[4][4];
+} Mat4;
+
+f32        geometry_camera_horizon         (const Camera*, const f32);
+Vec3D      geometry_camera_transform       (const Camera*, const Vec3D);
+CameraView geometry_camera_view            (const Camera*);
+Vec3D      geometry_camera_view_transform  (const CameraView*, const Vec3D);
+Mat4       geometry_camera_view_matrix     (const Camera*);
+Mat4       geometry_camera_projection      (const Camera*, const f32);
+Mat4       geometry_camera_view_projection (const Camera*, const f32);
+bool       geometry_camera_equal           (const Camera*, const Camera*);
+
+Mat4  geometry_mat4_identity        (void);
+Mat4  geometry_mat4_mul             (const Mat4*, const Mat4*);
+Mat4  geometry_mat4_model           (const Vec3D, const Vec3D, const Vec3D, const Vec3D, const f32);
+void  geometry_mat4_transform_batch (const Mat4*, const f32*, const f32*, const f32*,
+                                     f32*, f32*, f32*, f32*, const u64);
 
 f32   geometry_scalar_abs     (const f32);
 bool  geometry_scalar_equals  (const f32, const f32, const f32);
@@ -1,5 +1,10 @@
 #include "geometry.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEOMETRY_X86
+#endif
+
 f32 graphics_camera_horizon(const Camera* cam, const f32 screen_height) {
   return (screen_height / 2.0f) * (1 + tan(cam->pitch));
 }
@@ -63,31 +68,224 @@ Vec3D geometry_vec3d_mirror(const Vec3D v, const u8 dim) {
 }
 
 Vec3D geometry_camera_transform(const Camera* cam, const Vec3D point) {
+  const CameraView view = geometry_camera_view(cam);
+  return geometry_camera_view_transform(&view, point);
+}
+
+CameraView geometry_camera_view(const Camera* cam) {
+  return (CameraView){
+    .position  = cam->position,
+    .cos_pitch = cosf(cam->pitch),
+    .sin_pitch = sinf(cam->pitch),
+    .cos_yaw   = cosf(cam->yaw),
+    .sin_yaw   = sinf(cam->yaw)
+  };
+}
+
+Vec3D geometry_camera_view_transform(const CameraView* view, const Vec3D point) {
   Vec3D relative = {
-    point.x - cam->position.x,
-    point.y - cam->position.y,
-    point.z - cam->position.z
+    point.x - view->position.x,
+    point.y - view->position.y,
+    point.z - view->position.z
   };
-  
-  const f32
-    cos_pitch = cosf(cam->pitch),
-    sin_pitch = sinf(cam->pitch);
-  
-  const f32 
-    y_rotated = relative.y * cos_pitch - relative.z * sin_pitch,
-    z_rotated = relative.y * sin_pitch + relative.z * cos_pitch;
-  
+
   const f32 
-    cos_yaw = cosf(cam->yaw),
-    sin_yaw = sinf(cam->yaw);
-  
+    y_rotated = relative.y * view->cos_pitch - relative.z * view->sin_pitch,
+    z_rotated = relative.y * view->sin_pitch + relative.z * view->cos_pitch;
+
   const f32 
-    x_final = relative.x * cos_yaw + z_rotated * sin_yaw,
-    z_final = -relative.x * sin_yaw + z_rotated * cos_yaw;
+    x_final = relative.x * view->cos_yaw + z_rotated * view->sin_yaw,
+    z_final = -relative.x * view->sin_yaw + z_rotated * view->cos_yaw;
 
   return (Vec3D){ .x = x_final, .y = y_rotated, .z = z_final };
 }
 
+// View rotation from geometry_camera_view_transform, applied after moving
+// the camera to the origin.
+Mat4 geometry_camera_view_matrix(const Camera* cam) {
+  const CameraView view = geometry_camera_view(cam);
+  const f32
+    cp = view.cos_pitch, sp = view.sin_pitch,
+    cy = view.cos_yaw,   sy = view.sin_yaw;
+  const f32 rotation[3][3] = {
+    {  cy,  sp * sy, cp * sy },
+    { 0.0f, cp,      -sp     },
+    { -sy,  sp * cy, cp * cy }
+  };
+
+  Mat4 matrix = geometry_mat4_identity();
+  for (u32 r = 0; r < 3; r++) {
+    for (u32 c = 0; c < 3; c++)
+      matrix.m[r][c] = rotation[r][c];
+    matrix.m[r][3] = -(
+      rotation[r][0] * cam->position.x +
+      rotation[r][1] * cam->position.y +
+      rotation[r][2] * cam->position.z
+    );
+  }
+  return matrix;
+}
+
+// Perspective with a vertical field of view, aspect = width / height, and
+// the far plane at infinity. Clip w is the distance along the view axis and
+// clip z is the near plane distance, so z <= w in front of the near plane
+// and z / w = near / distance, 1 at the near plane and 0 at infinity.
+Mat4 geometry_camera_projection(const Camera* cam, const f32 aspect) {
+  const f32 focal = 1.0f / tanf(cam->fov / 2.0f);
+  return (Mat4){ .m = {
+    { focal / aspect, 0.0f,  0.0f, 0.0f            },
+    { 0.0f,           focal, 0.0f, 0.0f            },
+    { 0.0f,           0.0f,  0.0f, cam->near_plane },
+    { 0.0f,           0.0f,  1.0f, 0.0f            }
+  } };
+}
+
+Mat4 geometry_camera_view_projection(const Camera* cam, const f32 aspect) {
+  const Mat4
+    view       = geometry_camera_view_matrix(cam),
+    projection = geometry_camera_projection(cam, aspect);
+  return geometry_mat4_mul(&projection, &view);
+}
+
+// Same view, so a frame rendered for one is valid for the other
+bool geometry_camera_equal(const Camera* a, const Camera* b) {
+  return
+    a->position.x == b->position.x && a->position.y == b->position.y && a->position.z == b->position.z &&
+    a->pitch == b->pitch && a->yaw == b->yaw && a->fov == b->fov && a->near_plane == b->near_plane;
+}
+
+Mat4 geometry_mat4_identity(void) {
+  return (Mat4){ .m = {
+    { 1.0f, 0.0f, 0.0f, 0.0f },
+    { 0.0f, 1.0f, 0.0f, 0.0f },
+    { 0.0f, 0.0f, 1.0f, 0.0f },
+    { 0.0f, 0.0f, 0.0f, 1.0f }
+  } };
+}
+
+// lhs * rhs, so rhs applies first
+Mat4 geometry_mat4_mul(const Mat4* lhs, const Mat4* rhs) {
+  Mat4 product;
+  for (u32 r = 0; r < 4; r++)
+    for (u32 c = 0; c < 4; c++)
+      product.m[r][c] =
+        lhs->m[r][0] * rhs->m[0][c] + lhs->m[r][1] * rhs->m[1][c] +
+        lhs->m[r][2] * rhs->m[2][c] + lhs->m[r][3] * rhs->m[3][c];
+  return product;
+}
+
+// Scales by scale, rotates into the basis right, up, forward, then moves to position
+Mat4 geometry_mat4_model(
+  const Vec3D position,
+  const Vec3D right, const Vec3D up, const Vec3D forward,
+  const f32 scale
+) {
+  return (Mat4){ .m = {
+    { scale * right.x, scale * up.x, scale * forward.x, position.x },
+    { scale * right.y, scale * up.y, scale * forward.y, position.y },
+    { scale * right.z, scale * up.z, scale * forward.z, position.z },
+    { 0.0f,            0.0f,         0.0f,              1.0f       }
+  } };
+}
+
+// Points with w = 1. The vector kernels keep the scalar operation order
+// (and no FMA), so every kernel produces bit-identical results and the tail
+// can be done in scalar.
+static void mat4_transform_scalar(
+  const Mat4* matrix,
+  const f32* restrict xs, const f32* restrict ys, const f32* restrict zs,
+  f32* restrict out_xs, f32* restrict out_ys, f32* restrict out_zs, f32* restrict out_ws,
+  const u64 start, const u64 count
+) {
+  const f32 (*m)[4] = matrix->m;
+  for (u64 i = start; i < count; i++) {
+    const f32 x = xs[i], y = ys[i], z = zs[i];
+    out_xs[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+    out_ys[i] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+    out_zs[i] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+    out_ws[i] = m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3];
+  }
+}
+
+#ifdef GEOMETRY_X86
+__attribute__((target("sse2")))
+static void mat4_transform_sse(
+  const Mat4* matrix,
+  const f32* restrict xs, const f32* restrict ys, const f32* restrict zs,
+  f32* restrict out_xs, f32* restrict out_ys, f32* restrict out_zs, f32* restrict out_ws,
+  const u64 count
+) {
+  __m128 m[4][4];
+  for (u32 r = 0; r < 4; r++)
+    for (u32 c = 0; c < 4; c++)
+      m[r][c] = _mm_set1_ps(matrix->m[r][c]);
+
+  f32* const out[4] = { out_xs, out_ys, out_zs, out_ws };
+
+  u64 i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128
+      x = _mm_loadu_ps(xs + i),
+      y = _mm_loadu_ps(ys + i),
+      z = _mm_loadu_ps(zs + i);
+
+    for (u32 r = 0; r < 4; r++)
+      _mm_storeu_ps(out[r] + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(m[r][0], x), _mm_mul_ps(m[r][1], y)), _mm_mul_ps(m[r][2], z)), m[r][3]));
+  }
+
+  mat4_transform_scalar(matrix, xs, ys, zs, out_xs, out_ys, out_zs, out_ws, i, count);
+}
+
+__attribute__((target("avx2")))
+static void mat4_transform_avx2(
+  const Mat4* matrix,
+  const f32* restrict xs, const f32* restrict ys, const f32* restrict zs,
+  f32* restrict out_xs, f32* restrict out_ys, f32* restrict out_zs, f32* restrict out_ws,
+  const u64 count
+) {
+  __m256 m[4][4];
+  for (u32 r = 0; r < 4; r++)
+    for (u32 c = 0; c < 4; c++)
+      m[r][c] = _mm256_set1_ps(matrix->m[r][c]);
+
+  f32* const out[4] = { out_xs, out_ys, out_zs, out_ws };
+
+  u64 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256
+      x = _mm256_loadu_ps(xs + i),
+      y = _mm256_loadu_ps(ys + i),
+      z = _mm256_loadu_ps(zs + i);
+
+    for (u32 r = 0; r < 4; r++)
+      _mm256_storeu_ps(out[r] + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(m[r][0], x), _mm256_mul_ps(m[r][1], y)), _mm256_mul_ps(m[r][2], z)), m[r][3]));
+  }
+
+  mat4_transform_scalar(matrix, xs, ys, zs, out_xs, out_ys, out_zs, out_ws, i, count);
+}
+#endif /* GEOMETRY_X86 */
+
+void geometry_mat4_transform_batch(
+  const Mat4* matrix,
+  const f32* xs, const f32* ys, const f32* zs,
+  f32* out_xs, f32* out_ys, f32* out_zs, f32* out_ws,
+  const u64 count
+) {
+#ifdef GEOMETRY_X86
+  if (SDL_HasAVX2()) {
+    mat4_transform_avx2(matrix, xs, ys, zs, out_xs, out_ys, out_zs, out_ws, count);
+    return;
+  }
+  if (SDL_HasSSE2()) {
+    mat4_transform_sse(matrix, xs, ys, zs, out_xs, out_ys, out_zs, out_ws, count);
+    return;
+  }
+#endif
+  mat4_transform_scalar(matrix, xs, ys, zs, out_xs, out_ys, out_zs, out_ws, 0, count);
+}
+
 Vec2D geometry_vec3d_to_2d(
   const Vec3D point, 
   const Vec3D unit_vector, 
@@ -3,45 +3,117 @@
 
 #include "utils.h"
 #include "geometry.h"
+#include "arena.h"
 
 typedef struct window Window;
 
+typedef enum depth_test {
+  DepthTestOff,
+  DepthTestLess,
+  DepthTestLessEqual
+} DepthTest;
+
+typedef enum shading {
+  ShadingFlat,    // graphics_render fills with the first vertex's color
+  ShadingGouraud  // and this interpolates the vertex colors
+} Shading;
+
+// How draws combine with the framebuffer, with alpha in [0, 1]
+typedef enum blend_mode {
+  BlendOver,    // alpha * src + (1 - alpha) * dst, a plain write when opaque
+  BlendAdd,     // dst + alpha * src, saturating
+  BlendMultiply // dst * (1 - alpha + alpha * src)
+} BlendMode;
+
+typedef enum sort_order {
+  SortFrontToBack, // Opaque triangles, so the depth test rejects hidden ones early
+  SortBackToFront  // Blended triangles, each painted over what is behind it
+} SortOrder;
+
 typedef struct {
   u32 count;      // Number of triangles currently in the queue
   u32 capacity;   // Max triangles allocated
+  Arena* arena;   // Frame arena the streams live in
+
+  // Render order of the first sorted triangles, NULL for submission order.
+  // Triangles queued after the sort follow in submission order.
+  u32* order;
+  u32 sorted;
+  struct sort_pool* pool; // Threads of parallel sorts, NULL until one runs
 
-  f32 *v1x, *v1y, *v1z;
+  // Clip space x, y and w
+  f32 *v1x, *v1y, *v1w;
   f32 *v1r, *v1g, *v1b;
 
-  f32 *v2x, *v2y, *v2z;
+  f32 *v2x, *v2y, *v2w;
   f32 *v2r, *v2g, *v2b;
 
-  f32 *v3x, *v3y, *v3z;
+  f32 *v3x, *v3y, *v3w;
   f32 *v3r, *v3g, *v3b;
 } RenderQueueSoA;
 
+// Work done by the rasterizer since the window was created
+typedef struct graphics_stats {
+  u64 triangles; // Triangles that survived setup
+  u64 pixels;    // Pixels written, after the depth test
+  u64 tiles;     // Screen tiles rasterized
+} GraphicsStats;
+
 typedef struct color {
   f32 r, g, b;
 } Color;
 
-Window* graphics_init              (const char*, const u32, const u32);
+// 8-bit channels packed as 0xAARRGGBB, the framebuffer's pixel layout
+typedef u32 ColorARGB8;
+
+#define ColorBlack (Color){ .r = 0.0f, .g = 0.0f, .b = 0.0f }
+#define ColorWhite (Color){ .r = 1.0f, .g = 1.0f, .b = 1.0f }
+#define ColorRed   (Color){ .r = 1.0f, .g = 0.0f, .b = 0.0f }
+#define ColorGreen (Color){ .r = 0.0f, .g = 1.0f, .b = 0.0f }
+#define ColorBlue  (Color){ .r = 0.0f, .g = 0.0f, .b = 1.0f }
+#define ColorGray  (Color){ .r = 0.5f, .g = 0.5f, .b = 0.5f }
+
+Window*         graphics_init              (const char*, const u32, const u32);
+Window*         graphics_init_headless     (const u32, const u32);
+void            graphics_set_threads       (Window*, const u32);
+void            graphics_set_depth         (Window*, const DepthTest, const bool);
+bool            graphics_set_vsync         (Window*, const bool);
+void            graphics_set_shading       (Window*, const Shading);
+void            graphics_set_blend         (Window*, const BlendMode);
+void            graphics_set_incremental   (Window*, const bool);
+void            graphics_invalidate        (Window*);
+f32             graphics_aspect            (const Window*);
+
+ColorARGB8      graphics_color_pack        (const Color, const u8);
+void            graphics_color_pack_batch  (const Window*, const f32*, const f32*, const f32*, const u8, ColorARGB8*, const u64);
+
+RenderQueueSoA* graphics_queue_create      (Arena*, const u32);
+void            graphics_queue_reset       (RenderQueueSoA*);
+void            graphics_queue_reserve     (RenderQueueSoA*, const u32);
+void            graphics_queue_sort        (RenderQueueSoA*, const SortOrder);
+void            graphics_queue_free        (RenderQueueSoA*);
+
+void            graphics_draw_points       (Window*, const Vec2D*, const u64, const Color, const u8);
+
+void            graphics_draw_line_2d      (Window*, const Line2D, const Color, const u8);
+void            graphics_draw_lines_2d     (Window*, const Line2D*, const u64, const Color, const u8);
+void            graphics_draw_line_3d      (Window*, const Mat4*, const Vec3D, const Vec3D, const Color, const u8);
 
-void    graphics_draw_points       (Window*, const Vec2D*, const u64, const Color, const u8);
+void            graphics_draw_triangle_2d  (Window*, const Triangle2D, const Color, const Color, const u8);
+void            graphics_draw_triangles_2d (Window*, const Triangle2D*, const u64, const Color, const Color, const u8);
 
-void    graphics_draw_line_2d      (Window*, const Line2D, const Color, const u8);
-void    graphics_draw_lines_2d     (Window*, const Line2D*, const u64, const Color, const u8);
-void    graphics_draw_line_3d      (Window*, const Camera*, const Vec3D, const Vec3D, 
-                                    const Vec3D, const Vec3D, const Color, const u8);
+void            graphics_render            (Window*, const RenderQueueSoA*);
 
-void    graphics_draw_triangle_2d  (Window*, const Triangle2D, const Color, const Color, const u8);
-void    graphics_draw_triangles_2d (Window*, const Triangle2D*, const u64, const Color, const Color, const u8);
+void            graphics_draw_cube_3d      (Window*, const Mat4*, const Cube3D*, const Color, const u8);
 
-void    graphics_draw_cube_3d      (Window*, const Camera*, const Cube3D*, const Vec3D, const Vec3D, const Color, const u8);
+void            graphics_delay             (const u32);
+void            graphics_clear             (Window*, const Color);
+void            graphics_present           (Window*);
 
-void    graphics_delay             (const u32);
-void    graphics_clear             (Window*, const Color);
-void    graphics_present           (Window*);
+GraphicsStats   graphics_stats             (const Window*);
+bool            graphics_save_ppm          (const Window*, const char*);
+bool            graphics_save_png          (const Window*, const char*);
 
-void    graphics_close             (Window*);
+void            graphics_close             (Window*);
 
 #endif /* __GRAPHICS_H__ */
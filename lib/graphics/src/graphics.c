@@ -1,37 +1,221 @@
 #include "graphics.h"
+#include "profile.h"
+
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GRAPHICS_X86
+#endif
+
+// Rasterizer positions are fixed point with 4 bits of subpixel precision
+#define RASTER_SUBPIXEL_BITS 4
+#define RASTER_SUBPIXEL      (1 << RASTER_SUBPIXEL_BITS)
+#define RASTER_BLOCK         8
+// Screen tiles binned and rasterized independently by the worker pool
+#define RASTER_TILE          64
+// Initial size of the per-window arena holding binned triangles
+#define RASTER_ARENA         (8 << 20)
+// Projected vertices further out than this are not representable in fixed point
+#define RASTER_MAX_COORD     4194304.0f
+// Per-vertex values shaded triangles interpolate: red, green, blue
+#define RASTER_ATTRIBUTES    3
+// Rasterizer helpers that must fold away once their state arguments are constant
+#define RASTER_INLINE        static inline __attribute__((always_inline))
+
+// Queue sort keys are the top bits of the summed vertex w, sorted 8 at a time
+#define SORT_KEY_BITS        24
+#define SORT_RADIX_BITS      8
+#define SORT_BUCKETS         (1 << SORT_RADIX_BITS)
+// Triangles per thread below which the sort stays on the calling thread
+#define SORT_PARALLEL        (1 << 16)
+#define SORT_MAX_THREADS     16
+
+// Pixel rectangle, inclusive on both ends
+struct raster_rect {
+  i32 min_x, min_y, max_x, max_y;
+};
+
+// Edge functions of a counter-clockwise triangle, evaluated at pixel centers.
+// A pixel is covered when all three values are >= 0; the top-left fill rule
+// is folded into c as a -1 bias on the edges that must not own their pixels.
+//
+// Depth is the inverse view depth 1/z, which is affine in screen space, as a
+// plane z_c + z_dx * x + z_dy * y over pixel centers. Larger values are nearer.
+//
+// Shaded triangles replace color with attributes: each is a plane of the
+// attribute times 1/z, also affine in screen space, divided by the depth
+// plane per pixel for perspective-correct values. Colors are in 0..255.
+struct raster_triangle {
+  struct raster_rect bounds;
+  i64 c[3], step_x[3], step_y[3];
+  u32 color;
+  u8  alpha;
+  BlendMode blend;
+
+  bool depth;
+  f32 z_c, z_dx, z_dy, z_min, z_max;
+
+  bool shade;
+  f32 a_c[RASTER_ATTRIBUTES], a_dx[RASTER_ATTRIBUTES], a_dy[RASTER_ATTRIBUTES];
+
+  u64 hash; // Of everything above, for incremental redraw
+};
+
+// Triangles set up for one submission, binned by screen tile. Each tile's
+// bin keeps submission order, so a tile renders the same whichever thread
+// picks it up. Triangles and indices live in the window's arena, which is
+// reset per submission.
+struct raster_bins {
+  u32 s_triangles;
+  struct raster_triangle* triangles;
+
+  u32 tiles_x, tiles_y;
+  u32* offsets;  // tiles + 1 prefix sums into indices
+  u32* cursor;   // tiles, fill position while binning
+  u32* indices;
+};
+
+// Slice of the tile schedule owned by one worker. Tiles are claimed with a
+// fetch-add on next, by the owner first and then by idle workers stealing.
+struct raster_queue {
+  atomic_uint next;
+  u32 end;
+  u8 padding[64 - sizeof(atomic_uint) - sizeof(u32)];
+};
+
+struct raster_pool {
+  u32 s_threads; // Including the calling thread
+  SDL_Thread** threads;
+  SDL_Semaphore *start, *done;
+  atomic_bool quit;
+
+  u32* schedule; // Non-empty tiles, grouped by owning worker
+  struct raster_queue* queues;
+};
+
+struct raster_worker {
+  Window* window;
+  u32 id;
+};
+
+// One thread's slice of a queue sort. Each pass counts the digits of the
+// slice, then scatters it from counts turned into offsets; slices scatter
+// in order, so the sort stays stable.
+struct sort_job {
+  const RenderQueueSoA* queue;
+  SortOrder order;
+  u32 begin, end, shift;
+  u32 *keys, *indices;          // Pass input
+  u32 *keys_out, *indices_out;  // Pass output
+  u32 counts[SORT_BUCKETS];
+};
+
+// Workers a queue keeps for its sorts, started by the first sort large enough
+// to need them. Each phase wakes one worker per job after the first, which
+// the calling thread runs; the workers take the other jobs in turn.
+struct sort_pool {
+  u32 s_threads; // Including the calling thread
+  SDL_Thread* threads[SORT_MAX_THREADS];
+  SDL_Semaphore *start, *done;
+  atomic_bool quit;
+
+  void (*phase)(struct sort_job*);
+  struct sort_job* jobs;
+  atomic_uint next;
+};
 
 struct window {
   u32 width, height;
   const char* title;
-  SDL_Window* window;
-  SDL_Renderer* renderer;
-};
+  SDL_Window* window;     // NULL for headless windows, which only render
+  SDL_Renderer* renderer; // into pixels
+  SDL_Texture* texture;
+  u32* pixels; // ARGB8888, width * height, uploaded once per frame
+
+  DepthTest depth_test;
+  bool depth_write;
+  Shading shading;
+  BlendMode blend;
+  bool avx2;     // Shaded rows and blends use the AVX2 kernels
+  f32* depth;    // 1/z per pixel, 0 is infinitely far
+  u32 hiz_pitch;
+  f32 *hiz_far;  // Per 8x8 block lower bound of depth
+  f32 *hiz_near; // Per 8x8 block upper bound of depth
+  f32 *tile_far; // Per tile lower bound of depth
 
-struct ColorRGB {
-  u8 red, green, blue;
+  Arena* arena;
+  struct raster_bins bins;
+  struct raster_pool pool;
+  struct raster_worker* workers;
+
+  // Incremental windows defer graphics_clear to the first render of the
+  // frame, which clears and redraws only the tiles whose signature, the
+  // hashes of the triangles binned to them, changed since the last frame.
+  bool incremental;
+  bool clear_pending;
+  u32 clear_color;
+  bool redraw;      // The submission in flight clears the tiles it draws
+  bool tiles_valid; // tile_hash describes what the framebuffer shows
+  bool changed;     // Since the last present
+  u64* tile_hash;
+
+  struct {
+    u64 triangles;
+    u64 tiles;
+    atomic_ullong pixels; // Summed once per submission by each worker
+  } stats;
 };
 
-struct ColorRGB color_map(const Color);
+static void raster_span(const Window*, u32*, const i32, const u32, const u8);
+static bool raster_setup(struct raster_triangle*, const Triangle2D, const f32*, const Color*, const u32, const u8, const BlendMode, const struct raster_rect);
+static u32  raster_key(const Window*, const struct raster_triangle*);
+static bool raster_triangle(Window*, const struct raster_triangle*, const struct raster_rect, u64*);
+static inline bool depth_pass(const DepthTest, const f32, const f32);
+static void image_row(const Window*, const u32, u8*);
+static void png_be32(u8*, const u32);
+static u32  png_crc(u32, const u8*, const u64);
+static void png_chunk(FILE*, const char[4], const u8*, const u64);
+static bool clip_line(f32*, f32*, f32*, f32*, const f32, const f32);
+static struct raster_rect viewport(const Window*);
+static Vec2D              viewport_map(const Window*, const f32, const f32, const f32);
+static void               draw_clip_line(Window*, const f32[4], const f32[4], const Color, const u8);
+static void               draw_border(Window*, const Triangle2D, const Color, const u8);
+
+static u64  hash_mix(const u64, const u64);
+static void frame_clear(Window*, const u32);
+static void frame_direct(Window*);
+static void tile_clear(Window*, const struct raster_rect, const u32);
+
+static void raster_begin(Window*, const u64);
+static void raster_submit(Window*);
+static u64  raster_tile(Window*, const u32);
+static void raster_work(Window*, const u32);
+static int  raster_worker(void*);
+static void raster_pool_start(Window*, const u32);
+static void raster_pool_stop(Window*);
+static Window* window_create(const char*, const u32, const u32);
 
-static f32 interpolate(const f32 y, const f32 y1, const f32 x1, const f32 y2, const f32 x2);
-static void swap(f32* x, f32* y);
+static void sort_keys(struct sort_job*);
+static void sort_count(struct sort_job*);
+static void sort_scatter(struct sort_job*);
+static void sort_run(struct sort_pool*, struct sort_job*, const u32, void (*)(struct sort_job*));
+static int  sort_worker(void*);
+static struct sort_pool* sort_pool_start(const u32);
+static void sort_pool_stop(struct sort_pool*);
 
 Window* graphics_init(const char* title, const u32 width, const u32 height) {
   assert(title != NULL);
-  
+
   if (!SDL_Init(SDL_INIT_VIDEO)) {
     fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
     return NULL;
   }
-  
-  Window* window = (Window*)malloc(sizeof(struct window));
-  assert(window != NULL);
-  
+
   u64 flags = 0; // Remove SDL_WINDOW_FULLSCREEN for testing
   SDL_Window* sdl_window = SDL_CreateWindow(title, width, height, flags);
   if (!sdl_window) {
     fprintf(stderr, "SDL_CreateWindow failed: %s\n", SDL_GetError());
-    free(window);
     SDL_Quit();
     return NULL;
   }
@@ -42,30 +226,421 @@ Window* graphics_init(const char* title, const u32 width, const u32 height) {
   if (!renderer) {
     fprintf(stderr, "SDL_CreateRenderer failed: %s\n", SDL_GetError());
     SDL_DestroyWindow(sdl_window);
-    free(window);
     SDL_Quit();
     return NULL;
   }
-  
+
+  SDL_Texture* texture = SDL_CreateTexture(
+    renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height
+  );
+  if (!texture) {
+    fprintf(stderr, "SDL_CreateTexture failed: %s\n", SDL_GetError());
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(sdl_window);
+    SDL_Quit();
+    return NULL;
+  }
+
+  Window* window = window_create(title, width, height);
+  window->window   = sdl_window;
+  window->renderer = renderer;
+  window->texture  = texture;
+
+  return window;
+}
+
+Window* graphics_init_headless(const u32 width, const u32 height) {
+  return window_create("headless", width, height);
+}
+
+static Window* window_create(const char* title, const u32 width, const u32 height) {
+  assert(width > 0 && height > 0);
+
+  Window* window = (Window*)malloc(sizeof(struct window));
+  assert(window != NULL);
+
+  u32* pixels = (u32*)malloc((u64)width * height * sizeof(u32));
+  assert(pixels != NULL);
+
+  const u32
+    tiles_x = (width + RASTER_TILE - 1) / RASTER_TILE,
+    tiles_y = (height + RASTER_TILE - 1) / RASTER_TILE;
+
+  u32
+    *offsets = (u32*)malloc((tiles_x * tiles_y + 1) * sizeof(u32)),
+    *cursor  = (u32*)malloc(tiles_x * tiles_y * sizeof(u32));
+  u64* tile_hash = (u64*)calloc(tiles_x * tiles_y, sizeof(u64));
+  assert(offsets != NULL && cursor != NULL && tile_hash != NULL);
+
+  const u32
+    hiz_pitch = (width + RASTER_BLOCK - 1) / RASTER_BLOCK,
+    hiz_rows  = (height + RASTER_BLOCK - 1) / RASTER_BLOCK;
+
+  f32
+    *depth    = (f32*)calloc((u64)width * height, sizeof(f32)),
+    *hiz_far  = (f32*)calloc(hiz_pitch * hiz_rows, sizeof(f32)),
+    *hiz_near = (f32*)calloc(hiz_pitch * hiz_rows, sizeof(f32)),
+    *tile_far = (f32*)calloc(tiles_x * tiles_y, sizeof(f32));
+  assert(depth != NULL && hiz_far != NULL && hiz_near != NULL && tile_far != NULL);
+
   *window = (Window){
     .width    = width,
     .height   = height,
     .title    = title,
-    .window   = sdl_window,
-    .renderer = renderer
+    .window   = NULL,
+    .renderer = NULL,
+    .texture  = NULL,
+    .pixels   = pixels,
+
+    .depth_test  = DepthTestOff,
+    .depth_write = false,
+    .shading     = ShadingFlat,
+    .blend       = BlendOver,
+#ifdef GRAPHICS_X86
+    .avx2        = SDL_HasAVX2(),
+#endif
+    .depth       = depth,
+    .hiz_pitch   = hiz_pitch,
+    .hiz_far     = hiz_far,
+    .hiz_near    = hiz_near,
+    .tile_far    = tile_far,
+
+    .arena    = arena_create(RASTER_ARENA),
+    .bins     = {
+      .tiles_x = tiles_x,
+      .tiles_y = tiles_y,
+      .offsets = offsets,
+      .cursor  = cursor
+    },
+
+    .incremental = false,
+    .tiles_valid = false,
+    .changed     = true,
+    .tile_hash   = tile_hash
   };
-  
+  window->stats.triangles = 0;
+  window->stats.tiles = 0;
+  atomic_init(&window->stats.pixels, 0);
+
+  raster_pool_start(window, 0);
+
   return window;
 }
 
+void graphics_set_threads(Window* window, const u32 s_threads) {
+  raster_pool_stop(window);
+  raster_pool_start(window, s_threads);
+}
+
+void graphics_set_depth(Window* window, const DepthTest test, const bool write) {
+  window->depth_test  = test;
+  window->depth_write = write;
+}
+
+void graphics_set_shading(Window* window, const Shading shading) {
+  window->shading = shading;
+}
+
+void graphics_set_blend(Window* window, const BlendMode blend) {
+  window->blend = blend;
+}
+
+// Frames of an incremental window must start with graphics_clear. Tiles
+// whose triangles match the last frame keep their pixels, and a frame that
+// changes nothing is not presented.
+void graphics_set_incremental(Window* window, const bool incremental) {
+  if (window->clear_pending)
+    frame_clear(window, window->clear_color);
+  window->incremental   = incremental;
+  window->clear_pending = false;
+  window->tiles_valid   = false;
+  window->changed       = true;
+}
+
+// Redraws and presents everything next frame, e.g. once the window was exposed
+void graphics_invalidate(Window* window) {
+  window->tiles_valid = false;
+  window->changed     = true;
+}
+
+// Makes graphics_present wait for the display's refresh; headless windows
+// have no display and report false.
+bool graphics_set_vsync(Window* window, const bool vsync) {
+  if (window->renderer == NULL)
+    return false;
+
+  if (!SDL_SetRenderVSync(window->renderer, vsync ? 1 : SDL_RENDERER_VSYNC_DISABLED)) {
+    fprintf(stderr, "SDL_SetRenderVSync failed: %s\n", SDL_GetError());
+    return false;
+  }
+  return true;
+}
+
+// Width over height, for geometry_camera_projection
+f32 graphics_aspect(const Window* window) {
+  return (f32)window->width / window->height;
+}
+
+static void queue_streams(RenderQueueSoA* queue, f32** streams[18]) {
+  f32** all[18] = {
+    &queue->v1x, &queue->v1y, &queue->v1w, &queue->v1r, &queue->v1g, &queue->v1b,
+    &queue->v2x, &queue->v2y, &queue->v2w, &queue->v2r, &queue->v2g, &queue->v2b,
+    &queue->v3x, &queue->v3y, &queue->v3w, &queue->v3r, &queue->v3g, &queue->v3b
+  };
+  memcpy(streams, all, sizeof(all));
+}
+
+RenderQueueSoA* graphics_queue_create(Arena* arena, const u32 capacity) {
+  assert(arena != NULL && capacity > 0);
+
+  RenderQueueSoA* queue = (RenderQueueSoA*)malloc(sizeof(RenderQueueSoA));
+  assert(queue != NULL);
+
+  queue->capacity = capacity;
+  queue->arena    = arena;
+  queue->pool     = NULL;
+  graphics_queue_reset(queue);
+
+  return queue;
+}
+
+// Starts a new frame in the queue's arena, which the caller has just reset.
+// The capacity reached in earlier frames is kept.
+void graphics_queue_reset(RenderQueueSoA* queue) {
+  f32** streams[18];
+  queue_streams(queue, streams);
+
+  for (u32 i = 0; i < 18; i++)
+    *streams[i] = (f32*)arena_alloc(queue->arena, queue->capacity * sizeof(f32));
+
+  queue->count  = 0;
+  queue->order  = NULL;
+  queue->sorted = 0;
+}
+
+// Makes room for s_triangles more, doubling the streams within the arena
+void graphics_queue_reserve(RenderQueueSoA* queue, const u32 s_triangles) {
+  if (queue->count + s_triangles <= queue->capacity)
+    return;
+
+  u32 capacity = 2 * queue->capacity;
+  if (capacity < queue->count + s_triangles)
+    capacity = queue->count + s_triangles;
+
+  f32** streams[18];
+  queue_streams(queue, streams);
+
+  for (u32 i = 0; i < 18; i++) {
+    f32* stream = (f32*)arena_alloc(queue->arena, capacity * sizeof(f32));
+    memcpy(stream, *streams[i], queue->count * sizeof(f32));
+    *streams[i] = stream;
+  }
+
+  queue->capacity = capacity;
+}
+
+static void sort_keys(struct sort_job* job) {
+  const RenderQueueSoA* queue = job->queue;
+
+  for (u32 i = job->begin; i < job->end; i++) {
+    // w is positive past the near plane, where floats order like their bits
+    const f32 w = queue->v1w[i] + queue->v2w[i] + queue->v3w[i];
+    u32 bits;
+    memcpy(&bits, &w, sizeof(bits));
+
+    const u32 key = bits >> (32 - SORT_KEY_BITS);
+    job->keys[i]    = job->order == SortFrontToBack ? key : ~key & ((1u << SORT_KEY_BITS) - 1);
+    job->indices[i] = i;
+  }
+}
+
+static void sort_count(struct sort_job* job) {
+  memset(job->counts, 0, sizeof(job->counts));
+  for (u32 i = job->begin; i < job->end; i++)
+    job->counts[(job->keys[i] >> job->shift) & (SORT_BUCKETS - 1)]++;
+}
+
+static void sort_scatter(struct sort_job* job) {
+  for (u32 i = job->begin; i < job->end; i++) {
+    const u32 slot = job->counts[(job->keys[i] >> job->shift) & (SORT_BUCKETS - 1)]++;
+    job->keys_out[slot]    = job->keys[i];
+    job->indices_out[slot] = job->indices[i];
+  }
+}
+
+// Runs one phase of every job, the first on the calling thread
+static void sort_run(struct sort_pool* pool, struct sort_job* jobs, const u32 s_jobs, void (*phase)(struct sort_job*)) {
+  if (s_jobs == 1) {
+    phase(&jobs[0]);
+    return;
+  }
+
+  pool->phase = phase;
+  pool->jobs  = jobs;
+  atomic_store_explicit(&pool->next, 1, memory_order_relaxed);
+  for (u32 j = 1; j < s_jobs; j++)
+    SDL_SignalSemaphore(pool->start);
+
+  phase(&jobs[0]);
+
+  for (u32 j = 1; j < s_jobs; j++)
+    SDL_WaitSemaphore(pool->done);
+}
+
+static int sort_worker(void* data) {
+  struct sort_pool* pool = (struct sort_pool*)data;
+
+  while (true) {
+    SDL_WaitSemaphore(pool->start);
+    if (atomic_load(&pool->quit))
+      break;
+
+    const u32 j = atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed);
+    pool->phase(&pool->jobs[j]);
+    SDL_SignalSemaphore(pool->done);
+  }
+
+  return 0;
+}
+
+static struct sort_pool* sort_pool_start(const u32 s_threads) {
+  struct sort_pool* pool = (struct sort_pool*)malloc(sizeof(struct sort_pool));
+  assert(pool != NULL);
+
+  pool->s_threads = s_threads;
+  pool->start     = SDL_CreateSemaphore(0);
+  pool->done      = SDL_CreateSemaphore(0);
+  assert(pool->start != NULL && pool->done != NULL);
+  atomic_init(&pool->quit, false);
+  atomic_init(&pool->next, 0);
+
+  pool->threads[0] = NULL;
+  for (u32 w = 1; w < s_threads; w++) {
+    pool->threads[w] = SDL_CreateThread(sort_worker, "sort", pool);
+    if (pool->threads[w] == NULL) {
+      fprintf(stderr, "SDL_CreateThread failed: %s\n", SDL_GetError());
+      pool->s_threads = w;
+      break;
+    }
+  }
+
+  return pool;
+}
+
+static void sort_pool_stop(struct sort_pool* pool) {
+  if (pool == NULL)
+    return;
+
+  atomic_store(&pool->quit, true);
+  for (u32 w = 1; w < pool->s_threads; w++)
+    SDL_SignalSemaphore(pool->start);
+  for (u32 w = 1; w < pool->s_threads; w++)
+    SDL_WaitThread(pool->threads[w], NULL);
+
+  SDL_DestroySemaphore(pool->start);
+  SDL_DestroySemaphore(pool->done);
+  free(pool);
+}
+
+// Orders the queued triangles by depth with an LSD radix sort into a
+// permutation in the queue's arena; the streams are left in place. Equal
+// keys keep submission order.
+void graphics_queue_sort(RenderQueueSoA* queue, const SortOrder order) {
+  const u32 count = queue->count;
+  queue->order  = NULL;
+  queue->sorted = 0;
+  if (count == 0)
+    return;
+
+  u32 s_jobs = count / SORT_PARALLEL;
+  if (s_jobs > 1) {
+    // One thread per core, up to SORT_MAX_THREADS, kept for later frames
+    if (queue->pool == NULL) {
+      const i32 cores = SDL_GetNumLogicalCPUCores();
+      queue->pool = sort_pool_start(cores < 1 ? 1 : cores > SORT_MAX_THREADS ? SORT_MAX_THREADS : (u32)cores);
+    }
+    if (s_jobs > queue->pool->s_threads)
+      s_jobs = queue->pool->s_threads;
+  } else
+    s_jobs = 1;
+
+  u32
+    *keys        = (u32*)arena_alloc(queue->arena, count * sizeof(u32)),
+    *indices     = (u32*)arena_alloc(queue->arena, count * sizeof(u32)),
+    *keys_out    = (u32*)arena_alloc(queue->arena, count * sizeof(u32)),
+    *indices_out = (u32*)arena_alloc(queue->arena, count * sizeof(u32));
+
+  struct sort_job jobs[SORT_MAX_THREADS];
+  for (u32 j = 0; j < s_jobs; j++)
+    jobs[j] = (struct sort_job){
+      .queue   = queue,
+      .order   = order,
+      .begin   = (u32)((u64)count * j / s_jobs),
+      .end     = (u32)((u64)count * (j + 1) / s_jobs),
+      .keys    = keys,
+      .indices = indices
+    };
+  sort_run(queue->pool, jobs, s_jobs, sort_keys);
+
+  for (u32 shift = 0; shift < SORT_KEY_BITS; shift += SORT_RADIX_BITS) {
+    for (u32 j = 0; j < s_jobs; j++) {
+      jobs[j].shift       = shift;
+      jobs[j].keys        = keys;
+      jobs[j].indices     = indices;
+      jobs[j].keys_out    = keys_out;
+      jobs[j].indices_out = indices_out;
+    }
+    sort_run(queue->pool, jobs, s_jobs, sort_count);
+
+    // A digit shared by every key would scatter everything back in place
+    bool uniform = false;
+    u32 offset = 0;
+    for (u32 d = 0; d < SORT_BUCKETS && !uniform; d++) {
+      u32 s_digit = 0;
+      for (u32 j = 0; j < s_jobs; j++) {
+        const u32 s_slice = jobs[j].counts[d];
+        jobs[j].counts[d] = offset + s_digit;
+        s_digit += s_slice;
+      }
+      offset += s_digit;
+      uniform = s_digit == count;
+    }
+    if (uniform)
+      continue;
+
+    sort_run(queue->pool, jobs, s_jobs, sort_scatter);
+
+    u32* t = keys; keys = keys_out; keys_out = t;
+    t = indices; indices = indices_out; indices_out = t;
+  }
+
+  queue->order  = indices;
+  queue->sorted = count;
+}
+
+void graphics_queue_free(RenderQueueSoA* queue) {
+  // The streams belong to the arena
+  sort_pool_stop(queue->pool);
+  free(queue);
+}
+
 void graphics_draw_points(
   Window* window,
   const Vec2D* points, const u64 s_points,
   const Color color, const u8 alpha
 ) {
-  struct ColorRGB rgb = COLORS[color];
-  SDL_SetRenderDrawColor(window->renderer, rgb.red, rgb.green, rgb.blue, alpha);
-  SDL_RenderPoints(window->renderer, (SDL_FPoint*)(points), s_points);
+  frame_direct(window);
+  const u32 argb = graphics_color_pack(color, 255);
+
+  for (u64 i = 0; i < s_points; i++) {
+    const i32
+      x = (i32)floorf(points[i].x),
+      y = (i32)floorf(points[i].y);
+    if (x < 0 || y < 0 || x >= (i32)window->width || y >= (i32)window->height)
+      continue;
+
+    raster_span(window, window->pixels + (u64)y * window->width + x, 1, argb, alpha);
+  }
 }
 
 
@@ -73,14 +648,41 @@ void graphics_draw_line_2d(
   Window* window, const Line2D line,
   const Color color, const u8 alpha
 ) {
-  struct ColorRGB rgb = COLORS[color];
-  SDL_SetRenderDrawColor(window->renderer, rgb.red, rgb.green, rgb.blue, alpha);
-  
-  SDL_RenderLine(
-    window->renderer, 
-    line.start.x, line.start.y,
-    line.end.x,   line.end.y
-  );
+  frame_direct(window);
+
+  f32
+    x1 = line.start.x, y1 = line.start.y,
+    x2 = line.end.x,   y2 = line.end.y;
+
+  if (!clip_line(&x1, &y1, &x2, &y2, window->width - 1, window->height - 1))
+    return;
+
+  const u32 argb = graphics_color_pack(color, 255);
+
+  // Bresenham over the clipped segment
+  i32
+    x = (i32)x1, y = (i32)y1;
+  const i32
+    xe = (i32)x2, ye = (i32)y2,
+    dx = abs(xe - x), sx = x < xe ? 1 : -1,
+    dy = -abs(ye - y), sy = y < ye ? 1 : -1;
+  i32 err = dx + dy;
+
+  while (true) {
+    raster_span(window, window->pixels + (u64)y * window->width + x, 1, argb, alpha);
+    if (x == xe && y == ye)
+      break;
+
+    const i32 e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y += sy;
+    }
+  }
 }
 
 void graphics_draw_lines_2d(
@@ -88,27 +690,23 @@ void graphics_draw_lines_2d(
   const Line2D* lines, const u64 s_lines,
   const Color color, const u8 alpha
 ) {
-  struct ColorRGB rgb = COLORS[color];
-  SDL_SetRenderDrawColor(window->renderer, rgb.red, rgb.green, rgb.blue, alpha);
-  
   for (u64 i = 0; i < s_lines; i++)
-    SDL_RenderLine(
-      window->renderer, 
-      lines[i].start.x, lines[i].start.y,
-      lines[i].end.x,   lines[i].end.y
-    );
+    graphics_draw_line_2d(window, lines[i], color, alpha);
 }
 
 void graphics_draw_line_3d(
-  Window* window, const Camera* cam,
-  const Vec3D v1, const Vec3D v2, const Vec3D unit_vector, const Vec3D origin,
+  Window* window, const Mat4* view_projection,
+  const Vec3D v1, const Vec3D v2,
   const Color color, const u8 alpha
 ) {
-  Line2D edge = (Line2D){
-    .start = geometry_vec3d_to_2d(geometry_camera_transform(cam, v1), unit_vector, origin),
-    .end   = geometry_vec3d_to_2d(geometry_camera_transform(cam, v2), unit_vector, origin)
-  };
-  graphics_draw_line_2d(window, edge, color, alpha);
+  const f32
+    xs[2] = { v1.x, v2.x },
+    ys[2] = { v1.y, v2.y },
+    zs[2] = { v1.z, v2.z };
+  f32 x[2], y[2], z[2], w[2];
+  geometry_mat4_transform_batch(view_projection, xs, ys, zs, x, y, z, w, 2);
+
+  draw_clip_line(window, (f32[4]){ x[0], y[0], z[0], w[0] }, (f32[4]){ x[1], y[1], z[1], w[1] }, color, alpha);
 }
 
 void graphics_draw_triangle_2d(
@@ -118,49 +716,21 @@ void graphics_draw_triangle_2d(
   const Color border_color,
   const u8 alpha
 ) {
-  struct ColorRGB fill = COLORS[fill_color];
-  
-  f32 
-    x1 = triangle.v1.x, y1 = triangle.v1.y,
-    x2 = triangle.v2.x, y2 = triangle.v2.y,
-    x3 = triangle.v3.x, y3 = triangle.v3.y;
-  
-  if (y2 < y1) {
-    swap(&x1, &x2);
-    swap(&y1, &y2);
-  }
-  if (y3 < y1) {
-    swap(&x1, &x3);
-    swap(&y1, &y3);
-  }
-  if (y3 < y2) {
-    swap(&x2, &x3);
-    swap(&y2, &y3);
-  }
-  
-  SDL_SetRenderDrawColor(window->renderer, fill.red, fill.green, fill.blue, alpha);
-  
-  // Top half
-  for (f32 y = y1; y <= y2; y++) {
-    f32
-      xa = interpolate(y, y1, x1, y3, x3),
-      xb = interpolate(y, y1, x1, y2, x2);
-    if (xa > xb)
-      swap(&xa, &xb);
-
-    SDL_RenderLine(window->renderer, xa, y, xb, y);
-  }
-  
-  // Bottom half
-  for (f32 y = y2 + 1; y <= y3; y++) {
-    f32
-      xa = interpolate(y, y1, x1, y3, x3),
-      xb = interpolate(y, y2, x2, y3, x3);
-    if (xa > xb)
-      swap(&xa, &xb);
-
-    SDL_RenderLine(window->renderer, xa, y, xb, y);
-  }
+  frame_direct(window);
+  const struct raster_rect screen = viewport(window);
+
+  struct raster_triangle setup;
+  if (!raster_setup(&setup, triangle, NULL, NULL, graphics_color_pack(fill_color, 255), alpha, window->blend, screen))
+    return;
+
+  u64 pixels = 0;
+  raster_triangle(window, &setup, screen, &pixels);
+  PROFILE_COUNT(ProfileTrianglesRasterized, 1);
+  window->stats.triangles++;
+  atomic_fetch_add_explicit(&window->stats.pixels, pixels, memory_order_relaxed);
+
+  if (graphics_color_pack(border_color, 255) != setup.color)
+    draw_border(window, triangle, border_color, alpha);
 }
 
 void graphics_draw_triangles_2d(
@@ -168,106 +738,1436 @@ void graphics_draw_triangles_2d(
   const Triangle2D* triangles, const u64 s_triangles,
   const Color color, const Color border_color, const u8 alpha
 ) {
+  frame_direct(window);
+  const struct raster_rect screen = viewport(window);
+  const u32 argb = graphics_color_pack(color, 255);
+  struct raster_bins* bins = &window->bins;
+
+  raster_begin(window, s_triangles);
   for (u64 i = 0; i < s_triangles; i++)
-    graphics_draw_triangle_2d(window, triangles[i], color, border_color, alpha);
+    if (raster_setup(&bins->triangles[bins->s_triangles], triangles[i], NULL, NULL, argb, alpha, window->blend, screen))
+      bins->s_triangles++;
+
+  raster_submit(window);
+
+  if (graphics_color_pack(border_color, 255) != argb)
+    for (u64 i = 0; i < s_triangles; i++)
+      draw_border(window, triangles[i], border_color, alpha);
+}
+
+void graphics_render(Window* window, const RenderQueueSoA* queue) {
+  const struct raster_rect screen = viewport(window);
+  struct raster_bins* bins = &window->bins;
+
+  raster_begin(window, queue->count);
+
+  // Flat fills take the first vertex's color, packed for the whole queue at once
+  u32* flat = (u32*)arena_alloc(window->arena, (queue->count > 0 ? queue->count : 1) * sizeof(u32));
+  graphics_color_pack_batch(window, queue->v1r, queue->v1g, queue->v1b, 255, flat, queue->count);
+
+  for (u32 k = 0; k < queue->count; k++) {
+    const u32 i = k < queue->sorted ? queue->order[k] : k;
+    const Triangle2D tri2d = {
+      .v1 = viewport_map(window, queue->v1x[i], queue->v1y[i], queue->v1w[i]),
+      .v2 = viewport_map(window, queue->v2x[i], queue->v2y[i], queue->v2w[i]),
+      .v3 = viewport_map(window, queue->v3x[i], queue->v3y[i], queue->v3w[i])
+    };
+    const f32 depth[3] = { 1.0f / queue->v1w[i], 1.0f / queue->v2w[i], 1.0f / queue->v3w[i] };
+    const Color colors[3] = {
+      { queue->v1r[i], queue->v1g[i], queue->v1b[i] },
+      { queue->v2r[i], queue->v2g[i], queue->v2b[i] },
+      { queue->v3r[i], queue->v3g[i], queue->v3b[i] }
+    };
+
+    if (raster_setup(
+          &bins->triangles[bins->s_triangles], tri2d, depth,
+          window->shading == ShadingGouraud ? colors : NULL, flat[i], 255, window->blend, screen
+        ))
+      bins->s_triangles++;
+  }
+
+  raster_submit(window);
 }
 
 void graphics_draw_cube_3d(
-  Window* window, const Camera* cam,
-  const Cube3D* c, const Vec3D unit_vector, const Vec3D origin,
-  const Color color, const u8 alpha
+  Window* window, const Mat4* view_projection,
+  const Cube3D* c, const Color color, const u8 alpha
 ) {
-  Vec3D vertices[8];
-
-  const f32 s = c->half_s_edge;
-  const Vec3D
-    scaled_right1   = geometry_vec3d_mul(c->right, s),
-    scaled_right2   = geometry_vec3d_mul(c->right, -s),
-    scaled_up1      = geometry_vec3d_mul(c->up, s),
-    scaled_up2      = geometry_vec3d_mul(c->up, -s),
-    scaled_forward1 = geometry_vec3d_mul(c->forward, s),
-    scaled_forward2 = geometry_vec3d_mul(c->forward, -s);
-  
-  Vec3D offsets[8] = {
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right1, scaled_up1), scaled_forward1),
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right2, scaled_up1), scaled_forward1),
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right2, scaled_up2), scaled_forward1),
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right1, scaled_up2), scaled_forward1),
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right1, scaled_up1), scaled_forward2),
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right2, scaled_up1), scaled_forward2),
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right2, scaled_up2), scaled_forward2),
-    geometry_vec3d_add(geometry_vec3d_add(scaled_right1, scaled_up2), scaled_forward2)
-  };
+  // Corners of the unit cube, scaled and placed by the cube's own matrix;
+  // each is transformed once and shared by its three edges
+  static const f32
+    xs[8] = { 1, -1, -1,  1,  1, -1, -1,  1 },
+    ys[8] = { 1,  1, -1, -1,  1,  1, -1, -1 },
+    zs[8] = { 1,  1,  1,  1, -1, -1, -1, -1 };
 
-  for (int i = 0; i < 8; i++)
-    vertices[i] = geometry_vec3d_add(c->center, offsets[i]);
+  const Mat4
+    placement = geometry_mat4_model(c->center, c->right, c->up, c->forward, c->half_s_edge),
+    mvp = geometry_mat4_mul(view_projection, &placement);
 
-  for (u8 i = 0; i < 4; i++)
-    graphics_draw_line_3d(window, cam, vertices[i], vertices[(i + 1) % 4], unit_vector, origin, color, alpha);
-  for (u8 i = 0; i < 4; i++)
-    graphics_draw_line_3d(window, cam, vertices[4 + i], vertices[4 + ((i + 1) % 4)], unit_vector, origin, color, alpha);
-  for (u8 i = 0; i < 4; i++)
-    graphics_draw_line_3d(window, cam, vertices[i], vertices[4 + i], unit_vector, origin, color, alpha);
+  f32 x[8], y[8], z[8], w[8];
+  geometry_mat4_transform_batch(&mvp, xs, ys, zs, x, y, z, w, 8);
+
+  f32 corners[8][4];
+  for (u32 i = 0; i < 8; i++) {
+    corners[i][0] = x[i]; corners[i][1] = y[i];
+    corners[i][2] = z[i]; corners[i][3] = w[i];
+  }
+
+  for (u8 i = 0; i < 4; i++) {
+    draw_clip_line(window, corners[i],     corners[(i + 1) % 4],     color, alpha);
+    draw_clip_line(window, corners[4 + i], corners[4 + (i + 1) % 4], color, alpha);
+    draw_clip_line(window, corners[i],     corners[4 + i],           color, alpha);
+  }
 }
 
+// Sleeps one frame period at fps; see lib/scheduler for pacing a loop
 void graphics_delay(const u32 fps) {
-  SDL_Delay((u32)(1 / ((float)(fps))));
+  SDL_DelayNS(SDL_NS_PER_SECOND / fps);
 }
 
 void graphics_clear(Window* window, const Color color) {
-  const struct ColorRGB rgb = color_map(color);
-  SDL_SetRenderDrawColor(window->renderer, rgb.red, rgb.green, rgb.blue, 255);
-  SDL_RenderClear(window->renderer);
+  const u32 argb = graphics_color_pack(color, 255);
+
+  if (window->incremental) {
+    window->clear_pending = true;
+    window->clear_color   = argb;
+    return;
+  }
+  frame_clear(window, argb);
 }
 
 void graphics_present(Window* window) {
+  // A clear that no render picked up
+  if (window->clear_pending)
+    frame_direct(window);
+
+  if (window->incremental && !window->changed)
+    return;
+  window->changed = false;
+
+  if (window->texture == NULL)
+    return;
+
+  SDL_UpdateTexture(window->texture, NULL, window->pixels, window->width * sizeof(u32));
+  SDL_RenderTexture(window->renderer, window->texture, NULL, NULL);
   SDL_RenderPresent(window->renderer);
 }
 
 void graphics_close(Window* window) {
   if (window) {
-    SDL_DestroyRenderer(window->renderer);
-    SDL_DestroyWindow(window->window);
+    raster_pool_stop(window);
+    arena_free(window->arena);
+    free(window->bins.offsets);
+    free(window->bins.cursor);
+    free(window->depth);
+    free(window->hiz_far);
+    free(window->hiz_near);
+    free(window->tile_far);
+    free(window->tile_hash);
+    if (window->window != NULL) {
+      SDL_DestroyTexture(window->texture);
+      SDL_DestroyRenderer(window->renderer);
+      SDL_DestroyWindow(window->window);
+    }
+    free(window->pixels);
     free(window);
   }
   SDL_Quit();
 }
 
-struct ColorRGB color_map(const Color c) {
-  struct ColorRGB rgb;
+GraphicsStats graphics_stats(const Window* window) {
+  return (GraphicsStats){
+    .triangles = window->stats.triangles,
+    .pixels    = atomic_load_explicit(&((Window*)window)->stats.pixels, memory_order_relaxed),
+    .tiles     = window->stats.tiles
+  };
+}
+
+bool graphics_save_ppm(const Window* window, const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return false;
+  }
+
+  fprintf(file, "P6\n%u %u\n255\n", window->width, window->height);
 
-  f32 r = c.r * 255.0f;
-  if (r < 0)
-    r = 0;
-  if (r > 255)
-    r = 255;
-  rgb.red = (u8)r;
+  u8* row = (u8*)malloc(3 * window->width);
+  assert(row != NULL);
 
-  f32 g = c.g * 255.0f;
-  if (g < 0)
-    g = 0;
-  if (g > 255)
-    g = 255;
-  rgb.green = (u8)g;
+  bool ok = true;
+  for (u32 y = 0; y < window->height && ok; y++) {
+    image_row(window, y, row);
+    ok = fwrite(row, 3, window->width, file) == window->width;
+  }
 
-  f32 b = c.b * 255.0f;
-  if (b < 0)
-    b = 0;
-  if (b > 255)
-    b = 255;
-  rgb.blue = (u8)b;
+  free(row);
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "Failed to write %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+// Uncompressed PNG: the zlib stream is a run of stored deflate blocks, which
+// keeps the writer small and the dump fast.
+bool graphics_save_png(const Window* window, const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return false;
+  }
 
-  return rgb;
+  // Scanlines are a filter byte followed by RGB
+  const u64
+    s_row   = 1 + 3 * (u64)window->width,
+    s_raw   = s_row * window->height,
+    s_block = 65535,
+    s_idat  = 2 + s_raw + 5 * ((s_raw + s_block - 1) / s_block) + 4;
+
+  static const u8 signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  u8 header[13];
+  png_be32(header,     window->width);
+  png_be32(header + 4, window->height);
+  header[8]  = 8; // Bit depth
+  header[9]  = 2; // RGB
+  header[10] = 0;
+  header[11] = 0;
+  header[12] = 0;
+
+  fwrite(signature, 1, sizeof(signature), file);
+  png_chunk(file, "IHDR", header, sizeof(header));
+
+  u8* idat = (u8*)malloc(s_idat);
+  u8* row  = (u8*)malloc(s_row);
+  assert(idat != NULL && row != NULL);
+
+  u64 at = 0, s_left = 0;
+  u32 a = 1, b = 0; // Adler-32 of the raw stream
+  idat[at++] = 0x78;
+  idat[at++] = 0x01;
+  for (u32 y = 0; y < window->height; y++) {
+    row[0] = 0;
+    image_row(window, y, row + 1);
+
+    for (u64 i = 0; i < s_row; i++) {
+      if (s_left == 0) {
+        const u64 s_done = (u64)y * s_row + i;
+        s_left = s_raw - s_done < s_block ? s_raw - s_done : s_block;
+        idat[at++] = s_done + s_left == s_raw;
+        idat[at++] = s_left & 0xff;
+        idat[at++] = s_left >> 8;
+        idat[at++] = ~s_left & 0xff;
+        idat[at++] = (~s_left >> 8) & 0xff;
+      }
+      idat[at++] = row[i];
+      s_left--;
+
+      a = (a + row[i]) % 65521;
+      b = (b + a) % 65521;
+    }
+  }
+  png_be32(idat + at, (b << 16) | a);
+  at += 4;
+  assert(at == s_idat);
+
+  png_chunk(file, "IDAT", idat, s_idat);
+  png_chunk(file, "IEND", NULL, 0);
+
+  free(idat);
+  free(row);
+  if (ferror(file) || fclose(file) != 0) {
+    fprintf(stderr, "Failed to write %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+// Channels clamp to [0, 1] and truncate to 8 bits
+static u32 color_channel(const f32 c) {
+  f32 v = c * 255.0f;
+  if (v < 0)
+    v = 0;
+  if (v > 255)
+    v = 255;
+  return (u32)v;
+}
+
+ColorARGB8 graphics_color_pack(const Color c, const u8 alpha) {
+  return (u32)alpha << 24 | color_channel(c.r) << 16 | color_channel(c.g) << 8 | color_channel(c.b);
+}
+
+static void color_pack_scalar(
+  const f32* r, const f32* g, const f32* b, const u8 alpha,
+  ColorARGB8* out, const u64 start, const u64 count
+) {
+  for (u64 i = start; i < count; i++)
+    out[i] = (u32)alpha << 24 | color_channel(r[i]) << 16 | color_channel(g[i]) << 8 | color_channel(b[i]);
+}
+
+#ifdef GRAPHICS_X86
+__attribute__((target("avx2")))
+static void color_pack_avx2(
+  const f32* r, const f32* g, const f32* b, const u8 alpha,
+  ColorARGB8* out, const u64 count
+) {
+  const __m256
+    scale = _mm256_set1_ps(255.0f),
+    zero  = _mm256_setzero_ps();
+  const __m256i a = _mm256_set1_epi32((i32)((u32)alpha << 24));
+
+  u64 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i
+      cr = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(r + i), scale), zero), scale)),
+      cg = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(g + i), scale), zero), scale)),
+      cb = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(b + i), scale), zero), scale));
+    _mm256_storeu_si256((__m256i*)(out + i), _mm256_or_si256(_mm256_or_si256(a, _mm256_slli_epi32(cr, 16)),
+      _mm256_or_si256(_mm256_slli_epi32(cg, 8), cb)));
+  }
+
+  color_pack_scalar(r, g, b, alpha, out, i, count);
+}
+#endif /* GRAPHICS_X86 */
+
+void graphics_color_pack_batch(
+  const Window* window,
+  const f32* r, const f32* g, const f32* b, const u8 alpha,
+  ColorARGB8* out, const u64 count
+) {
+#ifdef GRAPHICS_X86
+  if (window->avx2) {
+    color_pack_avx2(r, g, b, alpha, out, count);
+    return;
+  }
+#endif
+  (void)window;
+  color_pack_scalar(r, g, b, alpha, out, 0, count);
 }
 
-static f32 interpolate(const f32 y, const f32 y1, const f32 x1, const f32 y2, const f32 x2) {
-  if (y2 == y1)
-    return x1;
-  return x1 + (x2 - x1) * (y - y1) / (y2 - y1);
+// v / 255 rounded, exact for v <= 255 * 255 and without a divide
+static inline u32 div255(const u32 v) {
+  const u32 t = v + 128;
+  return (t + (t >> 8)) >> 8;
 }
 
-static void swap(f32* x, f32* y) {
-  f32 temp = *x;
-  *x = *y;
-  *y = temp;
+// Only ever inlined with a constant mode, like the rasterizer variants
+RASTER_INLINE u32 pixel_blend(const u32 dst, const u32 src, const u8 alpha, const BlendMode mode) {
+  const u32 a = alpha;
+  u32 argb = 0xFF000000u;
+  for (u32 shift = 0; shift < 24; shift += 8) {
+    const u32
+      s = (src >> shift) & 0xFF,
+      d = (dst >> shift) & 0xFF;
+    u32 v;
+    switch (mode) {
+      case BlendAdd:
+        v = d + div255(s * a);
+        if (v > 255)
+          v = 255;
+        break;
+      case BlendMultiply:
+        v = div255(d * div255((255 - a) * 255 + s * a));
+        break;
+      default:
+        v = div255(s * a + d * (255 - a));
+    }
+    argb |= v << shift;
+  }
+  return argb;
+}
+
+#ifdef GRAPHICS_X86
+// Eight pixels of pixel_blend, bit for bit. Channels widen to 16 bits, four
+// pixels to a half, so each product fits its lane.
+__attribute__((target("avx2")))
+RASTER_INLINE __m256i blend_avx2(const __m256i dst, const __m256i src, const u8 alpha, const BlendMode mode) {
+  const __m256i
+    zero = _mm256_setzero_si256(),
+    a    = _mm256_set1_epi16(alpha),
+    ia   = _mm256_set1_epi16(255 - alpha),
+    half = _mm256_set1_epi16(128),
+    opaque = _mm256_set1_epi32((i32)0xFF000000u);
+
+#define BLEND_DIV255(v) \
+  _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(v, half), _mm256_srli_epi16(_mm256_add_epi16(v, half), 8)), 8)
+
+  const __m256i
+    s_lo = _mm256_unpacklo_epi8(src, zero), s_hi = _mm256_unpackhi_epi8(src, zero),
+    d_lo = _mm256_unpacklo_epi8(dst, zero), d_hi = _mm256_unpackhi_epi8(dst, zero);
+
+  __m256i out;
+  switch (mode) {
+    case BlendAdd: {
+      const __m256i
+        lo = BLEND_DIV255(_mm256_mullo_epi16(s_lo, a)),
+        hi = BLEND_DIV255(_mm256_mullo_epi16(s_hi, a));
+      out = _mm256_adds_epu8(dst, _mm256_packus_epi16(lo, hi));
+      break;
+    }
+    case BlendMultiply: {
+      const __m256i
+        base = _mm256_mullo_epi16(ia, _mm256_set1_epi16(255)),
+        m_lo = BLEND_DIV255(_mm256_add_epi16(base, _mm256_mullo_epi16(s_lo, a))),
+        m_hi = BLEND_DIV255(_mm256_add_epi16(base, _mm256_mullo_epi16(s_hi, a)));
+      out = _mm256_packus_epi16(
+        BLEND_DIV255(_mm256_mullo_epi16(d_lo, m_lo)),
+        BLEND_DIV255(_mm256_mullo_epi16(d_hi, m_hi)));
+      break;
+    }
+    default: {
+      const __m256i
+        lo = _mm256_add_epi16(_mm256_mullo_epi16(s_lo, a), _mm256_mullo_epi16(d_lo, ia)),
+        hi = _mm256_add_epi16(_mm256_mullo_epi16(s_hi, a), _mm256_mullo_epi16(d_hi, ia));
+      out = _mm256_packus_epi16(BLEND_DIV255(lo), BLEND_DIV255(hi));
+    }
+  }
+#undef BLEND_DIV255
+
+  return _mm256_or_si256(out, opaque);
+}
+
+__attribute__((target("avx2")))
+RASTER_INLINE void blend_span_avx2(u32* row, const i32 s_row, const u32 color, const u8 alpha, const BlendMode mode) {
+  const __m256i src = _mm256_set1_epi32((i32)color);
+  i32 i = 0;
+  for (; i + 8 <= s_row; i += 8) {
+    const __m256i dst = _mm256_loadu_si256((const __m256i*)(row + i));
+    _mm256_storeu_si256((__m256i*)(row + i), blend_avx2(dst, src, alpha, mode));
+  }
+  for (; i < s_row; i++)
+    row[i] = pixel_blend(row[i], color, alpha, mode);
+}
+
+// AVX2 code cannot be inlined into the generic variants, so each mode gets
+// its own copy of the span
+#define BLEND_SPAN_AVX2(name, mode)                                               \
+  __attribute__((target("avx2")))                                                 \
+  static void name(u32* row, const i32 s_row, const u32 color, const u8 alpha) {  \
+    blend_span_avx2(row, s_row, color, alpha, mode);                              \
+  }
+
+BLEND_SPAN_AVX2(blend_span_over_avx2,     BlendOver)
+BLEND_SPAN_AVX2(blend_span_add_avx2,      BlendAdd)
+BLEND_SPAN_AVX2(blend_span_multiply_avx2, BlendMultiply)
+#endif /* GRAPHICS_X86 */
+
+// Blends one color over a run of pixels
+RASTER_INLINE void blend_span(const Window* window, u32* row, const i32 s_row, const u32 color, const u8 alpha, const BlendMode mode) {
+#ifdef GRAPHICS_X86
+  if (window->avx2) {
+    if (mode == BlendAdd)
+      blend_span_add_avx2(row, s_row, color, alpha);
+    else if (mode == BlendMultiply)
+      blend_span_multiply_avx2(row, s_row, color, alpha);
+    else
+      blend_span_over_avx2(row, s_row, color, alpha);
+    return;
+  }
+#endif
+  (void)window;
+  for (i32 i = 0; i < s_row; i++)
+    row[i] = pixel_blend(row[i], color, alpha, mode);
+}
+
+static void raster_span(const Window* window, u32* row, const i32 s_row, const u32 color, const u8 alpha) {
+  if (alpha == 255 && window->blend == BlendOver) {
+    for (i32 i = 0; i < s_row; i++)
+      row[i] = color;
+    return;
+  }
+
+  blend_span(window, row, s_row, color, alpha, window->blend);
+}
+
+// Plane through values at the snapped vertices, in pixel units at pixel centers
+static void raster_plane(const i64 x[3], const i64 y[3], const f64 v[3], f32* c, f32* dx, f32* dy) {
+  const f64
+    ax = (f64)(x[1] - x[0]) / RASTER_SUBPIXEL, ay = (f64)(y[1] - y[0]) / RASTER_SUBPIXEL,
+    bx = (f64)(x[2] - x[0]) / RASTER_SUBPIXEL, by = (f64)(y[2] - y[0]) / RASTER_SUBPIXEL,
+    det = ax * by - ay * bx,
+    dv1 = v[1] - v[0],
+    dv2 = v[2] - v[0],
+    dvdx = (dv1 * by - dv2 * ay) / det,
+    dvdy = (dv2 * ax - dv1 * bx) / det,
+    x0 = (f64)x[0] / RASTER_SUBPIXEL - 0.5,
+    y0 = (f64)y[0] / RASTER_SUBPIXEL - 0.5;
+
+  *dx = (f32)dvdx;
+  *dy = (f32)dvdy;
+  *c  = (f32)(v[0] - dvdx * x0 - dvdy * y0);
+}
+
+static bool raster_setup(
+  struct raster_triangle* tri,
+  const Triangle2D triangle,
+  const f32* depth,
+  const Color* colors,
+  const u32 color, const u8 alpha,
+  const BlendMode blend,
+  const struct raster_rect clip
+) {
+  const f32 coords[6] = {
+    triangle.v1.x, triangle.v1.y,
+    triangle.v2.x, triangle.v2.y,
+    triangle.v3.x, triangle.v3.y
+  };
+  for (u32 i = 0; i < 6; i++)
+    if (!(geometry_scalar_abs(coords[i]) < RASTER_MAX_COORD))
+      return false;
+
+  i64
+    x[3] = {
+      (i64)lrintf(triangle.v1.x * RASTER_SUBPIXEL),
+      (i64)lrintf(triangle.v2.x * RASTER_SUBPIXEL),
+      (i64)lrintf(triangle.v3.x * RASTER_SUBPIXEL)
+    },
+    y[3] = {
+      (i64)lrintf(triangle.v1.y * RASTER_SUBPIXEL),
+      (i64)lrintf(triangle.v2.y * RASTER_SUBPIXEL),
+      (i64)lrintf(triangle.v3.y * RASTER_SUBPIXEL)
+    };
+  f32 z[3] = { 0.0f, 0.0f, 0.0f };
+  if (depth != NULL) {
+    z[0] = depth[0];
+    z[1] = depth[1];
+    z[2] = depth[2];
+  }
+
+  // Vertex colors only matter when they differ, otherwise the flat fill is exact
+  Color c[3];
+  const bool shade = depth != NULL && colors != NULL && (
+    colors[0].r != colors[1].r || colors[0].g != colors[1].g || colors[0].b != colors[1].b ||
+    colors[0].r != colors[2].r || colors[0].g != colors[2].g || colors[0].b != colors[2].b
+  );
+  if (shade) {
+    c[0] = colors[0];
+    c[1] = colors[1];
+    c[2] = colors[2];
+  }
+
+  const i64 area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+  if (area == 0)
+    return false;
+  if (area < 0) {
+    i64 t = x[1]; x[1] = x[2]; x[2] = t;
+    t = y[1]; y[1] = y[2]; y[2] = t;
+    const f32 tz = z[1]; z[1] = z[2]; z[2] = tz;
+    if (shade) {
+      const Color tc = c[1]; c[1] = c[2]; c[2] = tc;
+    }
+  }
+
+  i64
+    min_x = x[0], max_x = x[0],
+    min_y = y[0], max_y = y[0];
+  for (u32 i = 1; i < 3; i++) {
+    if (x[i] < min_x) min_x = x[i];
+    if (x[i] > max_x) max_x = x[i];
+    if (y[i] < min_y) min_y = y[i];
+    if (y[i] > max_y) max_y = y[i];
+  }
+
+  tri->bounds = (struct raster_rect){
+    .min_x = (i32)(min_x >> RASTER_SUBPIXEL_BITS),
+    .min_y = (i32)(min_y >> RASTER_SUBPIXEL_BITS),
+    .max_x = (i32)(max_x >> RASTER_SUBPIXEL_BITS),
+    .max_y = (i32)(max_y >> RASTER_SUBPIXEL_BITS)
+  };
+  if (tri->bounds.min_x < clip.min_x) tri->bounds.min_x = clip.min_x;
+  if (tri->bounds.min_y < clip.min_y) tri->bounds.min_y = clip.min_y;
+  if (tri->bounds.max_x > clip.max_x) tri->bounds.max_x = clip.max_x;
+  if (tri->bounds.max_y > clip.max_y) tri->bounds.max_y = clip.max_y;
+  if (tri->bounds.min_x > tri->bounds.max_x || tri->bounds.min_y > tri->bounds.max_y)
+    return false;
+
+  const i64 half = RASTER_SUBPIXEL / 2;
+  for (u32 i = 0; i < 3; i++) {
+    const u32
+      a = (i + 1) % 3,
+      b = (i + 2) % 3;
+    const i64
+      dx = x[b] - x[a],
+      dy = y[b] - y[a];
+    const bool top_left = (dy == 0 && dx > 0) || dy < 0;
+
+    tri->step_x[i] = -dy * RASTER_SUBPIXEL;
+    tri->step_y[i] =  dx * RASTER_SUBPIXEL;
+    tri->c[i]      = -dy * (half - x[a]) + dx * (half - y[a]) - (top_left ? 0 : 1);
+  }
+
+  tri->color = color;
+  tri->alpha = alpha;
+  tri->blend = blend;
+
+  tri->depth = depth != NULL;
+  if (tri->depth) {
+    raster_plane(x, y, (const f64[3]){ z[0], z[1], z[2] }, &tri->z_c, &tri->z_dx, &tri->z_dy);
+    tri->z_min = fminf(z[0], fminf(z[1], z[2]));
+    tri->z_max = fmaxf(z[0], fmaxf(z[1], z[2]));
+  }
+
+  tri->shade = shade;
+  if (shade)
+    for (u32 a = 0; a < RASTER_ATTRIBUTES; a++) {
+      f64 v[3];
+      for (u32 i = 0; i < 3; i++) {
+        const f32 channel = a == 0 ? c[i].r : a == 1 ? c[i].g : c[i].b;
+        v[i] = (f64)channel * 255.0 * z[i];
+      }
+      raster_plane(x, y, v, &tri->a_c[a], &tri->a_dx[a], &tri->a_dy[a]);
+    }
+
+  u64 hash = hash_mix(hash_mix(color, alpha), blend);
+  for (u32 i = 0; i < 3; i++) {
+    u32 bits;
+    memcpy(&bits, &z[i], sizeof(bits));
+    hash = hash_mix(hash_mix(hash_mix(hash, (u64)x[i]), (u64)y[i]), bits);
+  }
+  if (shade)
+    for (u32 a = 0; a < RASTER_ATTRIBUTES; a++) {
+      const f32 plane[3] = { tri->a_c[a], tri->a_dx[a], tri->a_dy[a] };
+      u32 bits[3];
+      memcpy(bits, plane, sizeof(bits));
+      hash = hash_mix(hash_mix(hash_mix(hash, bits[0]), bits[1]), bits[2]);
+    }
+  tri->hash = hash;
+
+  return true;
+}
+
+// One row of a shaded triangle over [x0, x1], at most a block wide, with the
+// edge functions w at (x0, y). Returns the pixels written.
+RASTER_INLINE u64 raster_shade_scalar(
+  const struct raster_triangle* tri,
+  u32* row, f32* zrow,
+  const i32 x0, const i32 x1, const i32 y,
+  const i64 w[3],
+  const bool covered,
+  const DepthTest test,
+  const bool write,
+  const bool blend,
+  const BlendMode mode
+) {
+  const f32 zy = tri->z_c + tri->z_dy * y;
+  f32 ay[RASTER_ATTRIBUTES];
+  for (u32 a = 0; a < RASTER_ATTRIBUTES; a++)
+    ay[a] = tri->a_c[a] + tri->a_dy[a] * y;
+
+  u64 pixels = 0;
+  for (i32 x = x0; x <= x1; x++) {
+    const i32 dx = x - x0;
+    if (!covered && (
+          (w[0] + tri->step_x[0] * dx) |
+          (w[1] + tri->step_x[1] * dx) |
+          (w[2] + tri->step_x[2] * dx)) < 0)
+      continue;
+
+    const f32 z = zy + tri->z_dx * x;
+    if (!depth_pass(test, z, zrow[x]))
+      continue;
+
+    const f32 inv = 1.0f / z;
+    u32 argb = 0xFF000000u;
+    for (u32 a = 0; a < RASTER_ATTRIBUTES; a++) {
+      f32 v = (ay[a] + tri->a_dx[a] * x) * inv;
+      if (v < 0)
+        v = 0;
+      if (v > 255)
+        v = 255;
+      argb |= (u32)(v + 0.5f) << (16 - 8 * a);
+    }
+
+    row[x] = blend ? pixel_blend(row[x], argb, tri->alpha, mode) : argb;
+    if (write)
+      zrow[x] = z;
+    pixels++;
+  }
+
+  return pixels;
+}
+
+#ifdef GRAPHICS_X86
+// The same row eight pixels at a time. Coverage tests the 64-bit edge
+// functions directly and 1/z is a reciprocal estimate refined by one Newton
+// step, close to a full divide at a fraction of its cost.
+__attribute__((target("avx2")))
+RASTER_INLINE u64 raster_shade_avx2(
+  const struct raster_triangle* tri,
+  u32* row, f32* zrow,
+  const i32 x0, const i32 x1, const i32 y,
+  const i64 w[3],
+  const bool covered,
+  const DepthTest test,
+  const bool write,
+  const bool blend,
+  const BlendMode mode
+) {
+  const __m256i
+    lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+    bit  = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+  u32 mask = (1u << (x1 - x0 + 1)) - 1;
+  if (!covered) {
+    __m256i
+      lo = _mm256_setzero_si256(),
+      hi = _mm256_setzero_si256();
+    for (u32 i = 0; i < 3; i++) {
+      const i64 s = tri->step_x[i];
+      lo = _mm256_or_si256(lo, _mm256_set_epi64x(w[i] + 3 * s, w[i] + 2 * s, w[i] + s, w[i]));
+      hi = _mm256_or_si256(hi, _mm256_set_epi64x(w[i] + 7 * s, w[i] + 6 * s, w[i] + 5 * s, w[i] + 4 * s));
+    }
+    const u32 negative =
+      (u32)_mm256_movemask_pd(_mm256_castsi256_pd(lo)) |
+      (u32)_mm256_movemask_pd(_mm256_castsi256_pd(hi)) << 4;
+    mask &= ~negative;
+  }
+  if (mask == 0)
+    return 0;
+
+  const __m256
+    xs = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x0), lane)),
+    z  = _mm256_add_ps(_mm256_set1_ps(tri->z_c + tri->z_dy * y), _mm256_mul_ps(_mm256_set1_ps(tri->z_dx), xs));
+
+  __m256i active = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((i32)mask), bit), bit);
+  if (test != DepthTestOff) {
+    const __m256
+      stored = _mm256_maskload_ps(zrow + x0, active),
+      pass = test == DepthTestLess
+        ? _mm256_cmp_ps(z, stored, _CMP_GT_OQ)
+        : _mm256_cmp_ps(z, stored, _CMP_GE_OQ);
+    mask &= (u32)_mm256_movemask_ps(pass);
+    if (mask == 0)
+      return 0;
+    active = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((i32)mask), bit), bit);
+  }
+
+  const __m256 r = _mm256_rcp_ps(z);
+  const __m256 inv = _mm256_mul_ps(r, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(z, r)));
+
+  __m256i argb = _mm256_set1_epi32((i32)0xFF000000u);
+  for (u32 a = 0; a < RASTER_ATTRIBUTES; a++) {
+    __m256 v = _mm256_mul_ps(_mm256_add_ps(
+      _mm256_set1_ps(tri->a_c[a] + tri->a_dy[a] * y),
+      _mm256_mul_ps(_mm256_set1_ps(tri->a_dx[a]), xs)), inv);
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+    const __m256i channel = _mm256_cvttps_epi32(_mm256_add_ps(v, _mm256_set1_ps(0.5f)));
+    argb = _mm256_or_si256(argb, _mm256_sll_epi32(channel, _mm_cvtsi32_si128(16 - 8 * (i32)a)));
+  }
+
+  if (blend) {
+    const __m256i dst = _mm256_maskload_epi32((const int*)(row + x0), active);
+    argb = blend_avx2(dst, argb, tri->alpha, mode);
+  }
+  _mm256_maskstore_epi32((int*)(row + x0), active, argb);
+  if (write)
+    _mm256_maskstore_ps(zrow + x0, active, z);
+
+  return (u64)__builtin_popcount(mask);
+}
+
+// One copy per blend state, for the same reason as BLEND_SPAN_AVX2
+#define RASTER_SHADE_AVX2(name, blend, mode)                                                  \
+  __attribute__((target("avx2")))                                                             \
+  static u64 name(                                                                            \
+    const struct raster_triangle* tri, u32* row, f32* zrow,                                   \
+    const i32 x0, const i32 x1, const i32 y, const i64 w[3],                                  \
+    const bool covered, const DepthTest test, const bool write                                \
+  ) {                                                                                         \
+    return raster_shade_avx2(tri, row, zrow, x0, x1, y, w, covered, test, write, blend, mode); \
+  }
+
+RASTER_SHADE_AVX2(raster_shade_opaque_avx2,   false, BlendOver)
+RASTER_SHADE_AVX2(raster_shade_over_avx2,     true,  BlendOver)
+RASTER_SHADE_AVX2(raster_shade_add_avx2,      true,  BlendAdd)
+RASTER_SHADE_AVX2(raster_shade_multiply_avx2, true,  BlendMultiply)
+#endif /* GRAPHICS_X86 */
+
+RASTER_INLINE u64 raster_shade(
+  const Window* window,
+  const struct raster_triangle* tri,
+  u32* row, f32* zrow,
+  const i32 x0, const i32 x1, const i32 y,
+  const i64 w[3],
+  const bool covered,
+  const DepthTest test,
+  const bool write,
+  const bool blend,
+  const BlendMode mode
+) {
+#ifdef GRAPHICS_X86
+  if (window->avx2) {
+    if (!blend)
+      return raster_shade_opaque_avx2(tri, row, zrow, x0, x1, y, w, covered, test, write);
+    if (mode == BlendAdd)
+      return raster_shade_add_avx2(tri, row, zrow, x0, x1, y, w, covered, test, write);
+    if (mode == BlendMultiply)
+      return raster_shade_multiply_avx2(tri, row, zrow, x0, x1, y, w, covered, test, write);
+    return raster_shade_over_avx2(tri, row, zrow, x0, x1, y, w, covered, test, write);
+  }
+#endif
+  return raster_shade_scalar(tri, row, zrow, x0, x1, y, w, covered, test, write, blend, mode);
+}
+
+// The rasterizer body, only ever inlined with constant state so each variant
+// below is compiled without the branches for features it does not use.
+// Returns true when the far bound of some block was raised, so the caller
+// can tighten the tile bound that summarizes it.
+RASTER_INLINE bool raster_triangle_body(
+  Window* window,
+  const struct raster_triangle* tri,
+  const struct raster_rect clip,
+  u64* pixels,
+  const DepthTest test,
+  const bool write,
+  const bool blend,
+  const BlendMode mode,
+  const bool shade
+) {
+  const u32 pitch = window->width;
+  bool raised = false;
+
+  const i32
+    min_x = tri->bounds.min_x > clip.min_x ? tri->bounds.min_x : clip.min_x,
+    min_y = tri->bounds.min_y > clip.min_y ? tri->bounds.min_y : clip.min_y,
+    max_x = tri->bounds.max_x < clip.max_x ? tri->bounds.max_x : clip.max_x,
+    max_y = tri->bounds.max_y < clip.max_y ? tri->bounds.max_y : clip.max_y;
+
+  for (i32 by = min_y & ~(RASTER_BLOCK - 1); by <= max_y; by += RASTER_BLOCK) {
+    const i32
+      y0 = by < min_y ? min_y : by,
+      y1 = by + RASTER_BLOCK - 1 > max_y ? max_y : by + RASTER_BLOCK - 1;
+
+    for (i32 bx = min_x & ~(RASTER_BLOCK - 1); bx <= max_x; bx += RASTER_BLOCK) {
+      const i32
+        x0 = bx < min_x ? min_x : bx,
+        x1 = bx + RASTER_BLOCK - 1 > max_x ? max_x : bx + RASTER_BLOCK - 1;
+
+      // Classify the block against each edge from its corners
+      i64 w[3];
+      bool
+        outside = false,
+        inside  = true;
+      for (u32 i = 0; i < 3; i++) {
+        w[i] = tri->c[i] + tri->step_x[i] * x0 + tri->step_y[i] * y0;
+
+        const i64
+          ex = tri->step_x[i] * (x1 - x0),
+          ey = tri->step_y[i] * (y1 - y0),
+          lo = w[i] + (ex < 0 ? ex : 0) + (ey < 0 ? ey : 0),
+          hi = w[i] + (ex > 0 ? ex : 0) + (ey > 0 ? ey : 0);
+
+        if (hi < 0)
+          outside = true;
+        if (lo < 0)
+          inside = false;
+      }
+      if (outside)
+        continue;
+
+      // Depth range of the triangle over the block, then the hierarchical test
+      const u32 block = (by / RASTER_BLOCK) * window->hiz_pitch + bx / RASTER_BLOCK;
+      f32
+        block_far  = 0.0f,
+        block_near = 0.0f;
+      bool all_pass = test == DepthTestOff;
+      if (test != DepthTestOff || write) {
+        const f32
+          zr = tri->z_c + tri->z_dx * x0 + tri->z_dy * y0,
+          ex = tri->z_dx * (x1 - x0),
+          ey = tri->z_dy * (y1 - y0),
+          lo = zr + (ex < 0 ? ex : 0) + (ey < 0 ? ey : 0),
+          hi = zr + (ex > 0 ? ex : 0) + (ey > 0 ? ey : 0);
+
+        block_far  = lo > tri->z_min ? lo : tri->z_min;
+        block_near = hi < tri->z_max ? hi : tri->z_max;
+
+        if (test != DepthTestOff) {
+          if (!depth_pass(test, block_near, window->hiz_far[block]))
+            continue;
+          all_pass = depth_pass(test, block_far, window->hiz_near[block]);
+        }
+      }
+
+      u32* row = window->pixels + (u64)y0 * pitch;
+      f32* zrow = window->depth + (u64)y0 * pitch;
+      if (shade) {
+        for (i32 y = y0; y <= y1; y++, row += pitch, zrow += pitch) {
+          *pixels += all_pass
+            ? raster_shade(window, tri, row, zrow, x0, x1, y, w, inside, DepthTestOff, write, blend, mode)
+            : raster_shade(window, tri, row, zrow, x0, x1, y, w, inside, test, write, blend, mode);
+          w[0] += tri->step_y[0];
+          w[1] += tri->step_y[1];
+          w[2] += tri->step_y[2];
+        }
+      } else if (inside && all_pass) {
+        *pixels += (u64)(x1 - x0 + 1) * (y1 - y0 + 1);
+        for (i32 y = y0; y <= y1; y++, row += pitch, zrow += pitch) {
+          if (blend)
+            blend_span(window, row + x0, x1 - x0 + 1, tri->color, tri->alpha, mode);
+          else
+            for (i32 x = x0; x <= x1; x++)
+              row[x] = tri->color;
+          if (write) {
+            const f32 zy = tri->z_c + tri->z_dy * y;
+            for (i32 x = x0; x <= x1; x++)
+              zrow[x] = zy + tri->z_dx * x;
+          }
+        }
+      } else {
+        for (i32 y = y0; y <= y1; y++, row += pitch, zrow += pitch) {
+          const f32 zy = tri->z_c + tri->z_dy * y;
+          i64
+            w0 = w[0],
+            w1 = w[1],
+            w2 = w[2];
+          for (i32 x = x0; x <= x1; x++) {
+            if ((w0 | w1 | w2) >= 0) {
+              const f32 z = zy + tri->z_dx * x;
+              if (all_pass || depth_pass(test, z, zrow[x])) {
+                row[x] = blend ? pixel_blend(row[x], tri->color, tri->alpha, mode) : tri->color;
+                (*pixels)++;
+                if (write)
+                  zrow[x] = z;
+              }
+            }
+            w0 += tri->step_x[0];
+            w1 += tri->step_x[1];
+            w2 += tri->step_x[2];
+          }
+          w[0] += tri->step_y[0];
+          w[1] += tri->step_y[1];
+          w[2] += tri->step_y[2];
+        }
+      }
+
+      // Keep the block bounds conservative. A depth test only ever raises
+      // stored values, so far may rise only when the block is fully covered;
+      // without a test, writes can also lower them.
+      if (write) {
+        if (window->hiz_near[block] < block_near)
+          window->hiz_near[block] = block_near;
+
+        const bool full = inside && x0 == bx && y0 == by &&
+          x1 == bx + RASTER_BLOCK - 1 && y1 == by + RASTER_BLOCK - 1;
+        if (test == DepthTestOff) {
+          const u32 tile = (by / RASTER_TILE) * window->bins.tiles_x + bx / RASTER_TILE;
+          if (full)
+            window->hiz_far[block] = block_far;
+          else if (window->hiz_far[block] > block_far)
+            window->hiz_far[block] = block_far;
+          if (window->tile_far[tile] > window->hiz_far[block])
+            window->tile_far[tile] = window->hiz_far[block];
+        } else if (full && window->hiz_far[block] < block_far) {
+          window->hiz_far[block] = block_far;
+          raised = true;
+        }
+      }
+    }
+  }
+
+  return raised;
+}
+
+// Variant keys pack the state a triangle is drawn with: the depth test above
+// the write bit, the blend state and the shade bit. The blend state is 0 for
+// opaque writes, otherwise the BlendMode plus one. Every key gets its own
+// copy of the body.
+#define RASTER_KEY_TEST(key)  ((DepthTest)((key) >> 4))
+#define RASTER_KEY_WRITE(key) (((key) >> 3 & 1) != 0)
+#define RASTER_KEY_BLEND(key) (((key) >> 1 & 3) != 0)
+#define RASTER_KEY_MODE(key)  ((BlendMode)(RASTER_KEY_BLEND(key) ? ((key) >> 1 & 3) - 1 : BlendOver))
+#define RASTER_KEY_SHADE(key) (((key) & 1) != 0)
+#define RASTER_VARIANTS       ((DepthTestLessEqual + 1) << 4)
+
+#define RASTER_VARIANT(key)                                                                 \
+  static bool raster_triangle_##key(                                                        \
+    Window* window, const struct raster_triangle* tri, const struct raster_rect clip, u64* pixels \
+  ) {                                                                                       \
+    return raster_triangle_body(window, tri, clip, pixels, RASTER_KEY_TEST(key),            \
+      RASTER_KEY_WRITE(key), RASTER_KEY_BLEND(key), RASTER_KEY_MODE(key), RASTER_KEY_SHADE(key)); \
+  }
+
+RASTER_VARIANT(0)  RASTER_VARIANT(1)  RASTER_VARIANT(2)  RASTER_VARIANT(3)
+RASTER_VARIANT(4)  RASTER_VARIANT(5)  RASTER_VARIANT(6)  RASTER_VARIANT(7)
+RASTER_VARIANT(8)  RASTER_VARIANT(9)  RASTER_VARIANT(10) RASTER_VARIANT(11)
+RASTER_VARIANT(12) RASTER_VARIANT(13) RASTER_VARIANT(14) RASTER_VARIANT(15)
+RASTER_VARIANT(16) RASTER_VARIANT(17) RASTER_VARIANT(18) RASTER_VARIANT(19)
+RASTER_VARIANT(20) RASTER_VARIANT(21) RASTER_VARIANT(22) RASTER_VARIANT(23)
+RASTER_VARIANT(24) RASTER_VARIANT(25) RASTER_VARIANT(26) RASTER_VARIANT(27)
+RASTER_VARIANT(28) RASTER_VARIANT(29) RASTER_VARIANT(30) RASTER_VARIANT(31)
+RASTER_VARIANT(32) RASTER_VARIANT(33) RASTER_VARIANT(34) RASTER_VARIANT(35)
+RASTER_VARIANT(36) RASTER_VARIANT(37) RASTER_VARIANT(38) RASTER_VARIANT(39)
+RASTER_VARIANT(40) RASTER_VARIANT(41) RASTER_VARIANT(42) RASTER_VARIANT(43)
+RASTER_VARIANT(44) RASTER_VARIANT(45) RASTER_VARIANT(46) RASTER_VARIANT(47)
+
+static bool (*const raster_variants[])(
+  Window*, const struct raster_triangle*, const struct raster_rect, u64*
+) = {
+  raster_triangle_0,  raster_triangle_1,  raster_triangle_2,  raster_triangle_3,
+  raster_triangle_4,  raster_triangle_5,  raster_triangle_6,  raster_triangle_7,
+  raster_triangle_8,  raster_triangle_9,  raster_triangle_10, raster_triangle_11,
+  raster_triangle_12, raster_triangle_13, raster_triangle_14, raster_triangle_15,
+  raster_triangle_16, raster_triangle_17, raster_triangle_18, raster_triangle_19,
+  raster_triangle_20, raster_triangle_21, raster_triangle_22, raster_triangle_23,
+  raster_triangle_24, raster_triangle_25, raster_triangle_26, raster_triangle_27,
+  raster_triangle_28, raster_triangle_29, raster_triangle_30, raster_triangle_31,
+  raster_triangle_32, raster_triangle_33, raster_triangle_34, raster_triangle_35,
+  raster_triangle_36, raster_triangle_37, raster_triangle_38, raster_triangle_39,
+  raster_triangle_40, raster_triangle_41, raster_triangle_42, raster_triangle_43,
+  raster_triangle_44, raster_triangle_45, raster_triangle_46, raster_triangle_47
+};
+
+// A new key bit or depth test needs its variants listed above
+_Static_assert(sizeof(raster_variants) / sizeof(raster_variants[0]) == RASTER_VARIANTS, "one variant per key");
+
+static u32 raster_key(const Window* window, const struct raster_triangle* tri) {
+  const DepthTest test = tri->depth ? window->depth_test : DepthTestOff;
+  const bool write = tri->depth && window->depth_write;
+  const u32 blend = tri->alpha == 255 && tri->blend == BlendOver ? 0 : (u32)tri->blend + 1;
+  return (u32)test << 4 | (u32)write << 3 | blend << 1 | (u32)tri->shade;
+}
+
+static bool raster_triangle(
+  Window* window,
+  const struct raster_triangle* tri,
+  const struct raster_rect clip,
+  u64* pixels
+) {
+  return raster_variants[raster_key(window, tri)](window, tri, clip, pixels);
+}
+
+// One framebuffer row as packed RGB
+static void image_row(const Window* window, const u32 y, u8* rgb) {
+  const u32* row = window->pixels + (u64)y * window->width;
+  for (u32 x = 0; x < window->width; x++) {
+    rgb[3 * x]     = (row[x] >> 16) & 0xff;
+    rgb[3 * x + 1] = (row[x] >> 8) & 0xff;
+    rgb[3 * x + 2] = row[x] & 0xff;
+  }
+}
+
+static void png_be32(u8* out, const u32 value) {
+  out[0] = value >> 24;
+  out[1] = value >> 16;
+  out[2] = value >> 8;
+  out[3] = value;
+}
+
+static u32 png_crc(u32 crc, const u8* data, const u64 size) {
+  static u32 table[256];
+  if (table[1] == 0)
+    for (u32 n = 0; n < 256; n++) {
+      u32 c = n;
+      for (u32 k = 0; k < 8; k++)
+        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+
+  for (u64 i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+static void png_chunk(FILE* file, const char type[4], const u8* data, const u64 size) {
+  u8 word[4];
+  png_be32(word, (u32)size);
+  fwrite(word, 1, 4, file);
+  fwrite(type, 1, 4, file);
+  if (size > 0)
+    fwrite(data, 1, size, file);
+
+  u32 crc = png_crc(0xffffffffu, (const u8*)type, 4);
+  crc = png_crc(crc, data, size);
+  png_be32(word, crc ^ 0xffffffffu);
+  fwrite(word, 1, 4, file);
+}
+
+static inline bool depth_pass(const DepthTest test, const f32 z, const f32 stored) {
+  switch (test) {
+    case DepthTestLess:      return z > stored;
+    case DepthTestLessEqual: return z >= stored;
+    default:                 return true;
+  }
+}
+
+// Liang-Barsky clip of a segment against [0, max_x] x [0, max_y]
+static bool clip_line(f32* x1, f32* y1, f32* x2, f32* y2, const f32 max_x, const f32 max_y) {
+  if (!isfinite(*x1) || !isfinite(*y1) || !isfinite(*x2) || !isfinite(*y2))
+    return false;
+
+  const f32
+    dx = *x2 - *x1,
+    dy = *y2 - *y1;
+  const f32
+    p[4] = { -dx, dx, -dy, dy },
+    q[4] = { *x1, max_x - *x1, *y1, max_y - *y1 };
+
+  f32
+    t0 = 0.0f,
+    t1 = 1.0f;
+  for (u32 i = 0; i < 4; i++) {
+    if (p[i] == 0.0f) {
+      if (q[i] < 0.0f)
+        return false;
+      continue;
+    }
+
+    const f32 t = q[i] / p[i];
+    if (p[i] < 0.0f) {
+      if (t > t1)
+        return false;
+      if (t > t0)
+        t0 = t;
+    } else {
+      if (t < t0)
+        return false;
+      if (t < t1)
+        t1 = t;
+    }
+  }
+  const f32 ox = *x1, oy = *y1;
+  *x1 = ox + t0 * dx;
+  *y1 = oy + t0 * dy;
+  *x2 = ox + t1 * dx;
+  *y2 = oy + t1 * dy;
+
+  return true;
+}
+
+static struct raster_rect viewport(const Window* window) {
+  return (struct raster_rect){
+    .min_x = 0,
+    .min_y = 0,
+    .max_x = (i32)window->width - 1,
+    .max_y = (i32)window->height - 1
+  };
+}
+
+// Clip space to pixels, with y pointing down
+static Vec2D viewport_map(const Window* window, const f32 x, const f32 y, const f32 w) {
+  const f32
+    half_width  = window->width / 2.0f,
+    half_height = window->height / 2.0f;
+  return (Vec2D){
+    .x =  x * half_width / w + half_width,
+    .y = -y * half_height / w + half_height
+  };
+}
+
+// Segment between two clip space points (x, y, z, w), cut at the near plane
+static void draw_clip_line(Window* window, const f32 a[4], const f32 b[4], const Color color, const u8 alpha) {
+  const f32
+    da = a[3] - a[2],
+    db = b[3] - b[2];
+  if (da < 0 && db < 0)
+    return;
+
+  f32 p[2][4];
+  for (u32 c = 0; c < 4; c++) {
+    p[0][c] = a[c];
+    p[1][c] = b[c];
+  }
+  if (da < 0 || db < 0) {
+    const f32 t = da / (da - db);
+    f32* behind = da < 0 ? p[0] : p[1];
+    for (u32 c = 0; c < 4; c++)
+      behind[c] = a[c] + (b[c] - a[c]) * t;
+  }
+
+  graphics_draw_line_2d(window, (Line2D){
+    .start = viewport_map(window, p[0][0], p[0][1], p[0][3]),
+    .end   = viewport_map(window, p[1][0], p[1][1], p[1][3])
+  }, color, alpha);
+}
+
+// Outline drawn over a filled triangle whose border color differs from the fill
+static void draw_border(Window* window, const Triangle2D triangle, const Color color, const u8 alpha) {
+  const Line2D edges[3] = {
+    { .start = triangle.v1, .end = triangle.v2 },
+    { .start = triangle.v2, .end = triangle.v3 },
+    { .start = triangle.v3, .end = triangle.v1 }
+  };
+  graphics_draw_lines_2d(window, edges, 3, color, alpha);
+}
+
+static u64 hash_mix(const u64 hash, const u64 value) {
+  u64 h = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+  return h ^ (h >> 29);
+}
+
+static void frame_clear(Window* window, const u32 argb) {
+  const u64 s_pixels = (u64)window->width * window->height;
+
+  for (u64 i = 0; i < s_pixels; i++)
+    window->pixels[i] = argb;
+
+  const u32 s_blocks = window->hiz_pitch * ((window->height + RASTER_BLOCK - 1) / RASTER_BLOCK);
+  memset(window->depth, 0, s_pixels * sizeof(f32));
+  memset(window->hiz_far, 0, s_blocks * sizeof(f32));
+  memset(window->hiz_near, 0, s_blocks * sizeof(f32));
+  memset(window->tile_far, 0, window->bins.tiles_x * window->bins.tiles_y * sizeof(f32));
+}
+
+// Drawing outside graphics_render applies a deferred clear first, and the
+// framebuffer then shows more than tile_hash describes
+static void frame_direct(Window* window) {
+  if (window->clear_pending) {
+    frame_clear(window, window->clear_color);
+    window->clear_pending = false;
+  }
+  if (window->incremental) {
+    window->tiles_valid = false;
+    window->changed     = true;
+  }
+}
+
+static void tile_clear(Window* window, const struct raster_rect rect, const u32 tile) {
+  const u32 pitch = window->width;
+  for (i32 y = rect.min_y; y <= rect.max_y; y++) {
+    u32* row = window->pixels + (u64)y * pitch;
+    for (i32 x = rect.min_x; x <= rect.max_x; x++)
+      row[x] = window->clear_color;
+    memset(window->depth + (u64)y * pitch + rect.min_x, 0, (rect.max_x - rect.min_x + 1) * sizeof(f32));
+  }
+
+  for (i32 by = rect.min_y / RASTER_BLOCK; by <= rect.max_y / RASTER_BLOCK; by++)
+    for (i32 bx = rect.min_x / RASTER_BLOCK; bx <= rect.max_x / RASTER_BLOCK; bx++) {
+      window->hiz_far[by * window->hiz_pitch + bx]  = 0.0f;
+      window->hiz_near[by * window->hiz_pitch + bx] = 0.0f;
+    }
+  window->tile_far[tile] = 0.0f;
+}
+
+static void raster_begin(Window* window, const u64 s_triangles) {
+  arena_reset(window->arena);
+
+  window->bins.s_triangles = 0;
+  window->bins.triangles = (struct raster_triangle*)arena_alloc(
+    window->arena, s_triangles * sizeof(struct raster_triangle)
+  );
+}
+
+// Bins the pending triangles by tile and rasterizes the tiles on the pool
+static void raster_submit(Window* window) {
+  struct raster_bins* bins = &window->bins;
+  struct raster_pool* pool = &window->pool;
+  const u32 s_tiles = bins->tiles_x * bins->tiles_y;
+
+  PROFILE_ZONE_BEGIN("raster bin");
+  PROFILE_COUNT(ProfileTrianglesRasterized, bins->s_triangles);
+
+  memset(bins->cursor, 0, s_tiles * sizeof(u32));
+  for (u32 i = 0; i < bins->s_triangles; i++) {
+    const struct raster_rect b = bins->triangles[i].bounds;
+    for (i32 ty = b.min_y / RASTER_TILE; ty <= b.max_y / RASTER_TILE; ty++)
+      for (i32 tx = b.min_x / RASTER_TILE; tx <= b.max_x / RASTER_TILE; tx++)
+        bins->cursor[ty * bins->tiles_x + tx]++;
+  }
+
+  bins->offsets[0] = 0;
+  for (u32 t = 0; t < s_tiles; t++) {
+    bins->offsets[t + 1] = bins->offsets[t] + bins->cursor[t];
+    bins->cursor[t] = bins->offsets[t];
+  }
+
+  // The first render of an incremental frame owns the deferred clear; any
+  // later one draws over it and leaves tiles the signatures cannot describe
+  window->redraw = window->incremental && window->clear_pending;
+  if (window->incremental && !window->redraw)
+    window->tiles_valid = false;
+  window->clear_pending = false;
+
+  const u32 s_indices = bins->offsets[s_tiles];
+  window->stats.triangles += bins->s_triangles;
+  if (s_indices == 0 && !window->redraw) {
+    PROFILE_ZONE_END("raster bin");
+    return;
+  }
+  bins->indices = (u32*)arena_alloc(window->arena, (s_indices > 0 ? s_indices : 1) * sizeof(u32));
+
+  for (u32 i = 0; i < bins->s_triangles; i++) {
+    const struct raster_rect b = bins->triangles[i].bounds;
+    for (i32 ty = b.min_y / RASTER_TILE; ty <= b.max_y / RASTER_TILE; ty++)
+      for (i32 tx = b.min_x / RASTER_TILE; tx <= b.max_x / RASTER_TILE; tx++)
+        bins->indices[bins->cursor[ty * bins->tiles_x + tx]++] = i;
+  }
+
+  // Tiles come out as they went in when the frame state and the triangles
+  // binned to them, in order, are the same; only the others are redrawn
+  if (window->redraw) {
+    const u64 state = hash_mix(hash_mix(hash_mix(
+      window->clear_color, window->depth_test), window->depth_write), window->shading);
+    for (u32 t = 0; t < s_tiles; t++) {
+      u64 hash = hash_mix(state, bins->offsets[t + 1] - bins->offsets[t]);
+      for (u32 i = bins->offsets[t]; i < bins->offsets[t + 1]; i++)
+        hash = hash_mix(hash, bins->triangles[bins->indices[i]].hash);
+
+      // Marks clean tiles by moving them out of their bins
+      if (window->tiles_valid && window->tile_hash[t] == hash)
+        bins->cursor[t] = UINT32_MAX;
+      window->tile_hash[t] = hash;
+    }
+    window->tiles_valid = true;
+  }
+
+  // Deal tiles to workers round-robin, so every worker starts out with a
+  // similar share of the triangles; stealing evens out the rest.
+  u32 s_schedule = 0;
+  for (u32 w = 0; w < pool->s_threads; w++) {
+    const u32 begin = s_schedule;
+    for (u32 t = w; t < s_tiles; t += pool->s_threads)
+      if (window->redraw ? bins->cursor[t] != UINT32_MAX : bins->offsets[t + 1] > bins->offsets[t])
+        pool->schedule[s_schedule++] = t;
+
+    atomic_store_explicit(&pool->queues[w].next, begin, memory_order_relaxed);
+    pool->queues[w].end = s_schedule;
+  }
+  window->stats.tiles += s_schedule;
+  if (window->incremental && s_schedule > 0)
+    window->changed = true;
+  PROFILE_ZONE_END("raster bin");
+
+  for (u32 w = 1; w < pool->s_threads; w++)
+    SDL_SignalSemaphore(pool->start);
+
+  raster_work(window, 0);
+
+  for (u32 w = 1; w < pool->s_threads; w++)
+    SDL_WaitSemaphore(pool->done);
+}
+
+// Returns the number of pixels written
+static u64 raster_tile(Window* window, const u32 tile) {
+  const struct raster_bins* bins = &window->bins;
+
+  const i32
+    tx = tile % bins->tiles_x,
+    ty = tile / bins->tiles_x;
+  const struct raster_rect rect = {
+    .min_x = tx * RASTER_TILE,
+    .min_y = ty * RASTER_TILE,
+    .max_x = (tx + 1) * RASTER_TILE > (i32)window->width  ? (i32)window->width  - 1 : (tx + 1) * RASTER_TILE - 1,
+    .max_y = (ty + 1) * RASTER_TILE > (i32)window->height ? (i32)window->height - 1 : (ty + 1) * RASTER_TILE - 1
+  };
+
+  if (window->redraw)
+    tile_clear(window, rect, tile);
+
+  u64 pixels = 0;
+  for (u32 i = bins->offsets[tile]; i < bins->offsets[tile + 1]; i++) {
+    const struct raster_triangle* tri = &bins->triangles[bins->indices[i]];
+
+    // Whole triangle behind everything already stored in the tile
+    if (tri->depth && window->depth_test != DepthTestOff &&
+        !depth_pass(window->depth_test, tri->z_max, window->tile_far[tile]))
+      continue;
+
+    if (!raster_triangle(window, tri, rect, &pixels))
+      continue;
+
+    f32 far = INFINITY;
+    for (i32 by = rect.min_y; by <= rect.max_y; by += RASTER_BLOCK)
+      for (i32 bx = rect.min_x; bx <= rect.max_x; bx += RASTER_BLOCK) {
+        const f32 block_far = window->hiz_far[(by / RASTER_BLOCK) * window->hiz_pitch + bx / RASTER_BLOCK];
+        if (far > block_far)
+          far = block_far;
+      }
+    window->tile_far[tile] = far;
+  }
+
+  return pixels;
+}
+
+static void raster_work(Window* window, const u32 id) {
+  struct raster_pool* pool = &window->pool;
+  u64 pixels = 0;
+
+  PROFILE_ZONE_BEGIN("raster tiles");
+  for (u32 k = 0; k < pool->s_threads; k++) {
+    struct raster_queue* queue = &pool->queues[(id + k) % pool->s_threads];
+    while (true) {
+      const u32 slot = atomic_fetch_add_explicit(&queue->next, 1, memory_order_relaxed);
+      if (slot >= queue->end)
+        break;
+      pixels += raster_tile(window, pool->schedule[slot]);
+    }
+  }
+
+  atomic_fetch_add_explicit(&window->stats.pixels, pixels, memory_order_relaxed);
+  PROFILE_ZONE_END("raster tiles");
+}
+
+static int raster_worker(void* data) {
+  const struct raster_worker* worker = (const struct raster_worker*)data;
+  struct raster_pool* pool = &worker->window->pool;
+
+  while (true) {
+    SDL_WaitSemaphore(pool->start);
+    if (atomic_load(&pool->quit))
+      break;
+
+    raster_work(worker->window, worker->id);
+    SDL_SignalSemaphore(pool->done);
+  }
+
+  return 0;
+}
+
+// A thread count of 0 uses one thread per logical core
+static void raster_pool_start(Window* window, const u32 s_threads) {
+  struct raster_pool* pool = &window->pool;
+
+  u32 n = s_threads;
+  if (n == 0) {
+    const i32 cores = SDL_GetNumLogicalCPUCores();
+    n = cores > 0 ? (u32)cores : 1;
+  }
+
+  pool->s_threads = n;
+  atomic_init(&pool->quit, false);
+
+  pool->schedule = (u32*)malloc(window->bins.tiles_x * window->bins.tiles_y * sizeof(u32));
+  pool->queues = (struct raster_queue*)aligned_alloc(64, n * sizeof(struct raster_queue));
+  assert(pool->schedule != NULL && pool->queues != NULL);
+  for (u32 w = 0; w < n; w++)
+    atomic_init(&pool->queues[w].next, 0);
+
+  pool->start   = SDL_CreateSemaphore(0);
+  pool->done    = SDL_CreateSemaphore(0);
+  pool->threads = (SDL_Thread**)malloc(n * sizeof(SDL_Thread*));
+  window->workers = (struct raster_worker*)malloc(n * sizeof(struct raster_worker));
+  assert(pool->start != NULL && pool->done != NULL);
+  assert(pool->threads != NULL && window->workers != NULL);
+
+  pool->threads[0] = NULL;
+  for (u32 w = 1; w < n; w++) {
+    window->workers[w] = (struct raster_worker){ .window = window, .id = w };
+    pool->threads[w] = SDL_CreateThread(raster_worker, "raster", &window->workers[w]);
+    if (pool->threads[w] == NULL) {
+      fprintf(stderr, "SDL_CreateThread failed: %s\n", SDL_GetError());
+      pool->s_threads = w;
+      break;
+    }
+  }
+}
+
+static void raster_pool_stop(Window* window) {
+  struct raster_pool* pool = &window->pool;
+
+  atomic_store(&pool->quit, true);
+  for (u32 w = 1; w < pool->s_threads; w++)
+    SDL_SignalSemaphore(pool->start);
+  for (u32 w = 1; w < pool->s_threads; w++)
+    SDL_WaitThread(pool->threads[w], NULL);
+
+  SDL_DestroySemaphore(pool->start);
+  SDL_DestroySemaphore(pool->done);
+  free(pool->threads);
+  free(pool->schedule);
+  free(pool->queues);
+  free(window->workers);
+
+  *pool = (struct raster_pool){ 0 };
+  window->workers = NULL;
 }
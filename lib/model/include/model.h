@@ -0,0 +1,75 @@
+#ifndef __MODEL_H__
+#define __MODEL_H__
+
+#include "utils.h"
+#include "geometry.h"
+#include "graphics.h"
+
+typedef struct model {
+  u32    s_vertices;
+  Vec3D* vertices;
+  u32    s_indices;
+  u32*   indices;
+  u16*   indices16; // Set instead of indices by model_optimize when every index fits
+  Color* colors; // maybe add vertex colors to add gradients
+  bool   double_sided; // Skips backface culling
+  Vec3D  min, max;     // Bounds of the vertices, see model_bounds
+
+  void*  mapping;   // Mesh file the streams point into, or NULL when owned
+  u64    s_mapping;
+} Model;
+
+// Placements of one model for graphics_clipper_instanced, a stream per field.
+// The axes are right-handed like Cube3D's and scale is positive, or front
+// faces are culled as back faces.
+typedef struct instances {
+  u32 count;
+  u32 capacity;
+
+  f32 *px, *py, *pz; // Position
+  f32 *rx, *ry, *rz; // Right, up and forward axes
+  f32 *ux, *uy, *uz;
+  f32 *fx, *fy, *fz;
+  f32 *scale;
+  f32 *r, *g, *b;    // Tint multiplied into the vertex colors
+} Instances;
+
+// Size and post-transform cache behavior of a model
+typedef struct model_stats {
+  u32 s_vertices, s_triangles;
+  f32 acmr;  // Vertices transformed per triangle through a FIFO cache of MODEL_CACHE_SIZE
+  u64 bytes; // Of the vertex, color and index streams
+} ModelStats;
+
+typedef struct platform {
+  const f32 width, length;
+  const u32 tiles;
+  Model* model;
+} Platform;
+
+Model* model_create         (const u32, const u32);
+Model* model_cube           (void);
+void   model_free           (Model*);
+
+Model* model_load_obj       (const char*);
+Model* model_load_mesh      (const char*);
+bool   model_save_mesh      (const Model*, const char*);
+
+void       model_bounds        (Model*);
+void       model_optimize      (Model*);
+ModelStats model_stats         (const Model*);
+
+void   platform_build_model (const Camera*, Platform*);
+
+Instances* instances_create    (const u32);
+void       instances_reset     (Instances*);
+void       instances_push      (Instances*, const Vec3D, const Vec3D, const Vec3D, const Vec3D,
+                                const f32, const Color);
+void       instances_push_cube (Instances*, const Cube3D*, const Color);
+void       instances_free      (Instances*);
+
+void   graphics_clipper           (const Mat4*, const Model*, RenderQueueSoA*);
+void   graphics_clipper_tinted    (const Mat4*, const Model*, const Color, RenderQueueSoA*);
+void   graphics_clipper_instanced (const Mat4*, const Model*, const Instances*, RenderQueueSoA*);
+
+#endif /* __MODEL_H__ */
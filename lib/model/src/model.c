@@ -0,0 +1,1244 @@
+#include "model.h"
+#include "profile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MODEL_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void mesh_unmap(void*, const u64);
+static u32  obj_hash(const Vec3D, const Color);
+
+static inline u32 model_index(const Model* model, const u32 i) {
+  return model->indices16 != NULL ? model->indices16[i] : model->indices[i];
+}
+
+Model* model_create(const u32 s_vertices, const u32 s_indices) {
+  assert(s_vertices > 0);
+
+  Model* model = (Model*)malloc(sizeof(struct model));
+  assert(model != NULL);
+
+  Vec3D* vertices = (Vec3D*)malloc(s_vertices * sizeof(struct vector3d));
+  assert(vertices != NULL);
+
+  u32* indices = (u32*)malloc(s_indices * sizeof(u32));
+  assert(indices != NULL);
+
+  Color* colors = (Color*)malloc(s_vertices * sizeof(struct color));
+  assert(colors != NULL);
+
+  *model = (Model){
+    .s_vertices   = s_vertices,
+    .vertices     = vertices,
+    .s_indices    = s_indices,
+    .indices      = indices,
+    .indices16    = NULL,
+    .colors       = colors,
+    .double_sided = false,
+    .min          = { 0.0f, 0.0f, 0.0f },
+    .max          = { 0.0f, 0.0f, 0.0f },
+    .mapping      = NULL,
+    .s_mapping    = 0
+  };
+
+  return model;
+}
+
+// Whoever fills or changes the vertices calls this; the loaders do
+void model_bounds(Model* model) {
+  Vec3D
+    lo = model->vertices[0],
+    hi = model->vertices[0];
+  for (u32 i = 1; i < model->s_vertices; i++) {
+    const Vec3D v = model->vertices[i];
+    lo = (Vec3D){ fminf(lo.x, v.x), fminf(lo.y, v.y), fminf(lo.z, v.z) };
+    hi = (Vec3D){ fmaxf(hi.x, v.x), fmaxf(hi.y, v.y), fmaxf(hi.z, v.z) };
+  }
+  model->min = lo;
+  model->max = hi;
+}
+
+// Cube of half edge 1 around the origin, white so instance tints show as is
+Model* model_cube(void) {
+  static const u32 faces[6][4] = {
+    { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 },
+    { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 }
+  };
+
+  Model* model = model_create(8, 36);
+  for (u32 k = 0; k < 8; k++) {
+    model->vertices[k] = (Vec3D){
+      k & 1 ? 1.0f : -1.0f,
+      k & 2 ? 1.0f : -1.0f,
+      k & 4 ? 1.0f : -1.0f
+    };
+    model->colors[k] = ColorWhite;
+  }
+
+  for (u32 f = 0; f < 6; f++) {
+    u32* indices = model->indices + 6 * f;
+    indices[0] = faces[f][0];
+    indices[1] = faces[f][1];
+    indices[2] = faces[f][2];
+    indices[3] = faces[f][0];
+    indices[4] = faces[f][2];
+    indices[5] = faces[f][3];
+  }
+  model_bounds(model);
+
+  return model;
+}
+
+void model_free(Model* model) {
+  if (model == NULL)
+    return;
+
+  // The streams point into the mapping
+  if (model->mapping != NULL) {
+    mesh_unmap(model->mapping, model->s_mapping);
+    free(model);
+    return;
+  }
+
+  if (model->vertices != NULL)
+    free(model->vertices);
+  if (model->indices != NULL)
+    free(model->indices);
+  if (model->indices16 != NULL)
+    free(model->indices16);
+  if (model->colors != NULL)
+    free(model->colors);
+
+  free(model);
+}
+
+// Binary mesh: a header followed by the vertex, color and index streams,
+// each at a 64-byte aligned offset and stored exactly as Model holds them,
+// so a mapped file is used in place. Version 2 added 16-bit indices.
+#define MESH_MAGIC   0x48534d5au // "ZMSH" in a little-endian file
+#define MESH_VERSION 2
+#define MESH_ALIGN   64
+
+enum mesh_flags {
+  MeshDoubleSided = 1 << 0,
+  MeshIndex16     = 1 << 1
+};
+
+struct mesh_header {
+  u32 magic, version;
+  u32 s_vertices, s_indices;
+  u32 flags, reserved;
+  u64 vertices, colors, indices; // Byte offsets into the file
+  u64 size;
+  u8  padding[8];
+};
+
+_Static_assert(sizeof(struct mesh_header) == MESH_ALIGN, "mesh header is one line");
+_Static_assert(sizeof(Vec3D) == 3 * sizeof(f32) && sizeof(Color) == 3 * sizeof(f32), "streams are packed f32");
+
+static u64 mesh_align(const u64 offset) {
+  return (offset + MESH_ALIGN - 1) & ~(u64)(MESH_ALIGN - 1);
+}
+
+static struct mesh_header mesh_layout(const u32 s_vertices, const u32 s_indices, const u32 flags) {
+  struct mesh_header header = {
+    .magic      = MESH_MAGIC,
+    .version    = MESH_VERSION,
+    .s_vertices = s_vertices,
+    .s_indices  = s_indices,
+    .flags      = flags
+  };
+  header.vertices = MESH_ALIGN;
+  header.colors   = mesh_align(header.vertices + (u64)s_vertices * sizeof(Vec3D));
+  header.indices  = mesh_align(header.colors + (u64)s_vertices * sizeof(Color));
+  header.size     = mesh_align(header.indices + (u64)s_indices * (flags & MeshIndex16 ? sizeof(u16) : sizeof(u32)));
+  return header;
+}
+
+bool model_save_mesh(const Model* model, const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return false;
+  }
+
+  const struct mesh_header header = mesh_layout(
+    model->s_vertices, model->s_indices,
+    (model->double_sided ? MeshDoubleSided : 0) | (model->indices16 != NULL ? MeshIndex16 : 0)
+  );
+  const u64 s_index_stream = model->indices16 != NULL
+    ? (u64)model->s_indices * sizeof(u16)
+    : (u64)model->s_indices * sizeof(u32);
+  static const u8 zeros[MESH_ALIGN] = { 0 };
+
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(model->vertices, sizeof(Vec3D), model->s_vertices, file);
+  fwrite(zeros, 1, header.colors - (header.vertices + (u64)model->s_vertices * sizeof(Vec3D)), file);
+  fwrite(model->colors, sizeof(Color), model->s_vertices, file);
+  fwrite(zeros, 1, header.indices - (header.colors + (u64)model->s_vertices * sizeof(Color)), file);
+  if (model->indices16 != NULL)
+    fwrite(model->indices16, sizeof(u16), model->s_indices, file);
+  else
+    fwrite(model->indices, sizeof(u32), model->s_indices, file);
+  fwrite(zeros, 1, header.size - (header.indices + s_index_stream), file);
+
+  if (ferror(file) || fclose(file) != 0) {
+    fprintf(stderr, "Failed to write %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+static void mesh_unmap(void* data, const u64 size) {
+#ifdef MODEL_MMAP
+  munmap(data, size);
+#else
+  SDL_free(data);
+#endif
+}
+
+// Maps the file privately, so the pages are shared with every other process
+// mapping it until someone writes to the model.
+Model* model_load_mesh(const char* path) {
+  u8* data = NULL;
+  u64 size = 0;
+
+#ifdef MODEL_MMAP
+  const i32 fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(struct mesh_header)) {
+    size = (u64)st.st_size;
+    data = (u8*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+      data = NULL;
+  }
+  close(fd);
+#else
+  size_t s_loaded = 0;
+  data = (u8*)SDL_LoadFile(path, &s_loaded);
+  size = s_loaded;
+#endif
+
+  if (data == NULL) {
+    fprintf(stderr, "Failed to map %s\n", path);
+    return NULL;
+  }
+
+  struct mesh_header header = { 0 };
+  if (size >= sizeof(header))
+    memcpy(&header, data, sizeof(header));
+
+  const struct mesh_header expected = mesh_layout(header.s_vertices, header.s_indices, header.flags);
+  // Version 1 files are version 2 files without 16-bit indices
+  if (header.magic != MESH_MAGIC || header.version < 1 || header.version > MESH_VERSION ||
+      (header.version < 2 && (header.flags & MeshIndex16)) ||
+      header.s_vertices == 0 || header.s_indices % 3 != 0 || header.vertices != expected.vertices ||
+      header.colors != expected.colors || header.indices != expected.indices ||
+      header.size != expected.size || header.size > size) {
+    fprintf(stderr, "%s is not a valid mesh\n", path);
+    mesh_unmap(data, size);
+    return NULL;
+  }
+
+  const bool index16 = header.flags & MeshIndex16;
+  for (u32 i = 0; i < header.s_indices; i++)
+    if ((index16 ? ((const u16*)(data + header.indices))[i] : ((const u32*)(data + header.indices))[i]) >= header.s_vertices) {
+      fprintf(stderr, "%s has an index out of range\n", path);
+      mesh_unmap(data, size);
+      return NULL;
+    }
+
+  Model* model = (Model*)malloc(sizeof(struct model));
+  assert(model != NULL);
+
+  *model = (Model){
+    .s_vertices   = header.s_vertices,
+    .vertices     = (Vec3D*)(data + header.vertices),
+    .s_indices    = header.s_indices,
+    .indices      = index16 ? NULL : (u32*)(data + header.indices),
+    .indices16    = index16 ? (u16*)(data + header.indices) : NULL,
+    .colors       = (Color*)(data + header.colors),
+    .double_sided = header.flags & MeshDoubleSided,
+    .mapping      = data,
+    .s_mapping    = size
+  };
+  model_bounds(model);
+
+  return model;
+}
+
+// Bytes read from an OBJ file at a time; no line may be longer
+#define OBJ_CHUNK (1 << 20)
+
+// Growable streams of the model being imported
+struct obj_builder {
+  u32 s_vertices, c_vertices;
+  Vec3D* vertices;
+  Color* colors;
+
+  u32 s_indices, c_indices;
+  u32* indices;
+
+  // OBJ position number to model vertex, after deduplication
+  u32 s_positions, c_positions;
+  u32* positions;
+
+  // Open addressing on position and color bits, UINT32_MAX marks empty
+  u32 c_table;
+  u32* table;
+};
+
+static u32 obj_hash(const Vec3D v, const Color c) {
+  const f32 key[6] = { v.x, v.y, v.z, c.r, c.g, c.b };
+  u32 bits[6];
+  memcpy(bits, key, sizeof(bits));
+
+  u32 hash = 2166136261u;
+  for (u32 i = 0; i < 6; i++) {
+    hash ^= bits[i];
+    hash *= 16777619u;
+    hash ^= hash >> 15;
+  }
+  return hash;
+}
+
+static void obj_table_insert(struct obj_builder* obj, const u32 vertex) {
+  u32 slot = obj_hash(obj->vertices[vertex], obj->colors[vertex]) & (obj->c_table - 1);
+  while (obj->table[slot] != UINT32_MAX)
+    slot = (slot + 1) & (obj->c_table - 1);
+  obj->table[slot] = vertex;
+}
+
+// Returns the model vertex for a position, adding it when it is new
+static u32 obj_vertex(struct obj_builder* obj, const Vec3D v, const Color c) {
+  if (2 * (obj->s_vertices + 1) > obj->c_table) {
+    free(obj->table);
+    obj->c_table = obj->c_table ? 2 * obj->c_table : 1024;
+    obj->table = (u32*)malloc(obj->c_table * sizeof(u32));
+    assert(obj->table != NULL);
+    memset(obj->table, 0xff, obj->c_table * sizeof(u32));
+    for (u32 i = 0; i < obj->s_vertices; i++)
+      obj_table_insert(obj, i);
+  }
+
+  u32 slot = obj_hash(v, c) & (obj->c_table - 1);
+  for (; obj->table[slot] != UINT32_MAX; slot = (slot + 1) & (obj->c_table - 1)) {
+    const u32 i = obj->table[slot];
+    if (memcmp(&obj->vertices[i], &v, sizeof(v)) == 0 && memcmp(&obj->colors[i], &c, sizeof(c)) == 0)
+      return i;
+  }
+
+  if (obj->s_vertices == obj->c_vertices) {
+    obj->c_vertices = obj->c_vertices ? 2 * obj->c_vertices : 1024;
+    obj->vertices = (Vec3D*)realloc(obj->vertices, obj->c_vertices * sizeof(Vec3D));
+    obj->colors = (Color*)realloc(obj->colors, obj->c_vertices * sizeof(Color));
+    assert(obj->vertices != NULL && obj->colors != NULL);
+  }
+
+  obj->vertices[obj->s_vertices] = v;
+  obj->colors[obj->s_vertices] = c;
+  obj->table[slot] = obj->s_vertices;
+  return obj->s_vertices++;
+}
+
+static void obj_triangle(struct obj_builder* obj, const u32 a, const u32 b, const u32 c) {
+  if (obj->s_indices + 3 > obj->c_indices) {
+    obj->c_indices = obj->c_indices ? 2 * obj->c_indices : 3072;
+    obj->indices = (u32*)realloc(obj->indices, obj->c_indices * sizeof(u32));
+    assert(obj->indices != NULL);
+  }
+
+  obj->indices[obj->s_indices++] = a;
+  obj->indices[obj->s_indices++] = b;
+  obj->indices[obj->s_indices++] = c;
+}
+
+// Parses one NUL-terminated line, returns false on malformed input
+static bool obj_line(struct obj_builder* obj, char* line) {
+  while (*line == ' ' || *line == '\t')
+    line++;
+
+  if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+    char* end = line + 2;
+    f32 value[7];
+    u32 s_values = 0;
+    for (; s_values < 7; s_values++) {
+      char* next;
+      const f32 x = strtof(end, &next);
+      if (next == end)
+        break;
+      value[s_values] = x;
+      end = next;
+    }
+    if (s_values < 3 || s_values == 5)
+      return false;
+
+    // x y z, an optional w that is ignored, then an optional colour
+    const f32* color = s_values >= 6 ? value + s_values - 3 : NULL;
+
+    // OBJ is right-handed; mirroring z keeps its winding front-facing here
+    const u32 vertex = obj_vertex(
+      obj,
+      (Vec3D){ value[0], value[1], -value[2] },
+      color == NULL ? ColorWhite : (Color){ .r = color[0], .g = color[1], .b = color[2] }
+    );
+
+    if (obj->s_positions == obj->c_positions) {
+      obj->c_positions = obj->c_positions ? 2 * obj->c_positions : 1024;
+      obj->positions = (u32*)realloc(obj->positions, obj->c_positions * sizeof(u32));
+      assert(obj->positions != NULL);
+    }
+    obj->positions[obj->s_positions++] = vertex;
+    return true;
+  }
+
+  if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+    char* end = line + 2;
+    u32 first = 0, prev = 0, s_corners = 0;
+    while (true) {
+      char* next;
+      const long index = strtol(end, &next, 10);
+      if (next == end)
+        break;
+      end = next;
+      // Texture and normal references are not used
+      while (*end != '\0' && *end != ' ' && *end != '\t')
+        end++;
+
+      const i64 position = index < 0 ? (i64)obj->s_positions + index : (i64)index - 1;
+      if (index == 0 || position < 0 || position >= obj->s_positions)
+        return false;
+
+      const u32 vertex = obj->positions[position];
+      if (s_corners == 0)
+        first = vertex;
+      else if (s_corners >= 2)
+        obj_triangle(obj, first, prev, vertex);
+      prev = vertex;
+      s_corners++;
+    }
+    return s_corners >= 3;
+  }
+
+  // Comments, normals, texture coordinates, groups and materials
+  return true;
+}
+
+// Streams the file through a fixed buffer, deduplicating positions as they
+// are read, and triangulates polygons as fans.
+Model* model_load_obj(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return NULL;
+  }
+
+  char* chunk = (char*)malloc(OBJ_CHUNK + 1);
+  assert(chunk != NULL);
+
+  struct obj_builder obj = { 0 };
+  u64 s_lines = 0, s_chunk = 0;
+  bool
+    ok  = true,
+    eof = false;
+  while (ok && !eof) {
+    const u64 s_read = fread(chunk + s_chunk, 1, OBJ_CHUNK - s_chunk, file);
+    eof = s_read < OBJ_CHUNK - s_chunk;
+    s_chunk += s_read;
+
+    char
+      *line = chunk,
+      *end  = chunk + s_chunk,
+      *newline;
+    while (ok && (newline = (char*)memchr(line, '\n', end - line)) != NULL) {
+      *newline = '\0';
+      s_lines++;
+      ok = obj_line(&obj, line);
+      line = newline + 1;
+    }
+
+    // The last line may lack a newline, any other must fit in the chunk
+    s_chunk = end - line;
+    if (ok && eof && s_chunk > 0) {
+      line[s_chunk] = '\0';
+      s_lines++;
+      ok = obj_line(&obj, line);
+    } else if (ok && s_chunk == OBJ_CHUNK) {
+      s_lines++;
+      ok = false;
+    }
+    memmove(chunk, line, s_chunk);
+  }
+
+  if (!ok)
+    fprintf(stderr, "%s: cannot parse line %llu\n", path, (unsigned long long)s_lines);
+  else if (ferror(file)) {
+    fprintf(stderr, "Failed to read %s\n", path);
+    ok = false;
+  } else if (obj.s_vertices == 0) {
+    fprintf(stderr, "%s has no vertices\n", path);
+    ok = false;
+  }
+
+  fclose(file);
+  free(chunk);
+  free(obj.positions);
+  free(obj.table);
+
+  if (!ok) {
+    free(obj.vertices);
+    free(obj.colors);
+    free(obj.indices);
+    return NULL;
+  }
+
+  Model* model = (Model*)malloc(sizeof(struct model));
+  assert(model != NULL);
+
+  *model = (Model){
+    .s_vertices   = obj.s_vertices,
+    .vertices     = (Vec3D*)realloc(obj.vertices, obj.s_vertices * sizeof(Vec3D)),
+    .s_indices    = obj.s_indices,
+    .indices      = obj.indices,
+    .indices16    = NULL,
+    .colors       = (Color*)realloc(obj.colors, obj.s_vertices * sizeof(Color)),
+    .double_sided = false,
+    .mapping      = NULL,
+    .s_mapping    = 0
+  };
+  assert(model->vertices != NULL && model->colors != NULL);
+  model_bounds(model);
+
+  return model;
+}
+
+// Post-transform cache size the triangle order is tuned for and ACMR assumes
+#define MODEL_CACHE_SIZE 32
+
+// Forsyth's vertex score: vertices used by the last triangle score a flat
+// 0.75 so the order does not stall on one strip, the rest of the cache
+// decays with position, and vertices with few triangles left get a boost so
+// they are finished off and leave the cache.
+static f32 optimize_vertex_score(const i32 position, const u32 remaining) {
+  if (remaining == 0)
+    return -1.0f;
+
+  f32 score = 0.0f;
+  if (position >= 0)
+    score = position < 3
+      ? 0.75f
+      : powf(1.0f - (f32)(position - 3) / (MODEL_CACHE_SIZE - 3), 1.5f);
+  return score + 2.0f / sqrtf((f32)remaining);
+}
+
+// Greedy triangle order for post-transform cache hits. The next triangle is
+// the best scored one touching the simulated cache, or the first one left
+// when none does.
+static void optimize_triangles(const u32* indices, const u32 s_indices, const u32 s_vertices, u32* out) {
+  const u32 s_triangles = s_indices / 3;
+
+  u32
+    *offsets   = (u32*)calloc(s_vertices + 1, sizeof(u32)),
+    *remaining = (u32*)calloc(s_vertices, sizeof(u32)),
+    *adjacency = (u32*)malloc(s_indices * sizeof(u32));
+  i32* position = (i32*)malloc(s_vertices * sizeof(i32));
+  f32
+    *vertex_score   = (f32*)malloc(s_vertices * sizeof(f32)),
+    *triangle_score = (f32*)malloc(s_triangles * sizeof(f32));
+  bool* emitted = (bool*)calloc(s_triangles, sizeof(bool));
+  assert(offsets != NULL && remaining != NULL && adjacency != NULL && position != NULL);
+  assert(vertex_score != NULL && triangle_score != NULL && emitted != NULL);
+
+  for (u32 i = 0; i < s_indices; i++)
+    remaining[indices[i]]++;
+  for (u32 v = 0; v < s_vertices; v++)
+    offsets[v + 1] = offsets[v] + remaining[v];
+  for (u32 i = 0; i < s_indices; i++)
+    adjacency[offsets[indices[i]]++] = i / 3;
+  for (u32 v = s_vertices; v > 0; v--)
+    offsets[v] = offsets[v - 1];
+  offsets[0] = 0;
+
+  for (u32 v = 0; v < s_vertices; v++) {
+    position[v] = -1;
+    vertex_score[v] = optimize_vertex_score(-1, remaining[v]);
+  }
+
+  i64 best = -1;
+  f32 best_score = -1.0f;
+  for (u32 t = 0; t < s_triangles; t++) {
+    const u32* tri = indices + 3 * t;
+    triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    if (triangle_score[t] > best_score) {
+      best_score = triangle_score[t];
+      best = t;
+    }
+  }
+
+  u32
+    cache[MODEL_CACHE_SIZE + 3],
+    s_cache = 0,
+    cursor  = 0;
+  for (u32 s_out = 0; s_out < s_indices; s_out += 3) {
+    if (best < 0) {
+      while (emitted[cursor])
+        cursor++;
+      best = cursor;
+    }
+
+    const u32 t = (u32)best;
+    const u32* tri = indices + 3 * t;
+    emitted[t] = true;
+
+    // The triangle's vertices move to the front of the cache
+    u32
+      next[MODEL_CACHE_SIZE + 3],
+      s_next = 0;
+    for (u32 k = 0; k < 3; k++) {
+      const u32 v = tri[k];
+      out[s_out + k] = v;
+
+      u32* adjacent = adjacency + offsets[v];
+      for (u32 j = 0; j < remaining[v]; j++)
+        if (adjacent[j] == t) {
+          adjacent[j] = adjacent[remaining[v] - 1];
+          break;
+        }
+      remaining[v]--;
+
+      bool seen = false;
+      for (u32 j = 0; j < s_next; j++)
+        seen |= next[j] == v;
+      if (!seen)
+        next[s_next++] = v;
+    }
+    const u32 s_front = s_next;
+    for (u32 c = 0; c < s_cache; c++) {
+      bool seen = false;
+      for (u32 j = 0; j < s_front; j++)
+        seen |= next[j] == cache[c];
+      if (!seen)
+        next[s_next++] = cache[c];
+    }
+
+    // Rescore what moved, including what fell out, and their triangles
+    best = -1;
+    best_score = -1.0f;
+    for (u32 c = 0; c < s_next; c++) {
+      const u32 v = next[c];
+      position[v] = c < MODEL_CACHE_SIZE ? (i32)c : -1;
+      vertex_score[v] = optimize_vertex_score(position[v], remaining[v]);
+    }
+    for (u32 c = 0; c < s_next; c++) {
+      const u32 v = next[c];
+      for (u32 j = 0; j < remaining[v]; j++) {
+        const u32 a = adjacency[offsets[v] + j];
+        const u32* other = indices + 3 * a;
+        triangle_score[a] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+        if (triangle_score[a] > best_score) {
+          best_score = triangle_score[a];
+          best = a;
+        }
+      }
+    }
+
+    s_cache = s_next < MODEL_CACHE_SIZE ? s_next : MODEL_CACHE_SIZE;
+    memcpy(cache, next, s_cache * sizeof(u32));
+  }
+
+  free(offsets);
+  free(remaining);
+  free(adjacency);
+  free(position);
+  free(vertex_score);
+  free(triangle_score);
+  free(emitted);
+}
+
+// Welds vertices with the same position and color, drops triangles that
+// collapse, orders triangles for the post-transform cache and then vertices
+// by first use, so the clipper's gathers walk its streams mostly forward.
+// Indices are narrowed to 16 bits when they fit. A mapped model is copied
+// out of its file first.
+void model_optimize(Model* model) {
+  const u32 s_in = model->s_vertices;
+
+  // Weld, by open addressing on the position and color bits
+  u32 c_table = 1024;
+  while (c_table < 2 * s_in)
+    c_table *= 2;
+  u32
+    *table = (u32*)malloc(c_table * sizeof(u32)),
+    *weld  = (u32*)malloc(s_in * sizeof(u32));
+  assert(table != NULL && weld != NULL);
+  memset(table, 0xff, c_table * sizeof(u32));
+
+  for (u32 v = 0; v < s_in; v++) {
+    const Vec3D p = model->vertices[v];
+    const Color c = model->colors[v];
+    u32 slot = obj_hash(p, c) & (c_table - 1);
+    for (; table[slot] != UINT32_MAX; slot = (slot + 1) & (c_table - 1)) {
+      const u32 u = table[slot];
+      if (memcmp(&model->vertices[u], &p, sizeof(p)) == 0 && memcmp(&model->colors[u], &c, sizeof(c)) == 0)
+        break;
+    }
+    if (table[slot] == UINT32_MAX)
+      table[slot] = v;
+    weld[v] = table[slot];
+  }
+  free(table);
+
+  u32* welded = (u32*)malloc((model->s_indices > 0 ? model->s_indices : 1) * sizeof(u32));
+  assert(welded != NULL);
+  u32 s_indices = 0;
+  for (u32 i = 0; i + 2 < model->s_indices; i += 3) {
+    const u32
+      a = weld[model_index(model, i)],
+      b = weld[model_index(model, i + 1)],
+      c = weld[model_index(model, i + 2)];
+    if (a == b || b == c || c == a)
+      continue;
+    welded[s_indices++] = a;
+    welded[s_indices++] = b;
+    welded[s_indices++] = c;
+  }
+  free(weld);
+
+  u32* ordered = (u32*)malloc((s_indices > 0 ? s_indices : 1) * sizeof(u32));
+  assert(ordered != NULL);
+  optimize_triangles(welded, s_indices, s_in, ordered);
+  free(welded);
+
+  // Vertices in first-use order; unused ones are dropped
+  u32* remap = (u32*)malloc(s_in * sizeof(u32));
+  assert(remap != NULL);
+  memset(remap, 0xff, s_in * sizeof(u32));
+  u32 s_vertices = 0;
+  for (u32 i = 0; i < s_indices; i++) {
+    if (remap[ordered[i]] == UINT32_MAX)
+      remap[ordered[i]] = s_vertices++;
+    ordered[i] = remap[ordered[i]];
+  }
+
+  // A model keeps at least one vertex
+  if (s_vertices == 0)
+    remap[0] = s_vertices++;
+
+  Vec3D* vertices = (Vec3D*)malloc(s_vertices * sizeof(Vec3D));
+  Color* colors = (Color*)malloc(s_vertices * sizeof(Color));
+  assert(vertices != NULL && colors != NULL);
+  for (u32 v = 0; v < s_in; v++)
+    if (remap[v] != UINT32_MAX) {
+      vertices[remap[v]] = model->vertices[v];
+      colors[remap[v]]   = model->colors[v];
+    }
+  free(remap);
+
+  u16* indices16 = NULL;
+  if (s_vertices <= UINT16_MAX + 1) {
+    indices16 = (u16*)malloc((s_indices > 0 ? s_indices : 1) * sizeof(u16));
+    assert(indices16 != NULL);
+    for (u32 i = 0; i < s_indices; i++)
+      indices16[i] = (u16)ordered[i];
+    free(ordered);
+    ordered = NULL;
+  }
+
+  const bool double_sided = model->double_sided;
+  if (model->mapping != NULL)
+    mesh_unmap(model->mapping, model->s_mapping);
+  else {
+    free(model->vertices);
+    free(model->indices);
+    free(model->indices16);
+    free(model->colors);
+  }
+
+  *model = (Model){
+    .s_vertices   = s_vertices,
+    .vertices     = vertices,
+    .s_indices    = s_indices,
+    .indices      = ordered,
+    .indices16    = indices16,
+    .colors       = colors,
+    .double_sided = double_sided,
+    .mapping      = NULL,
+    .s_mapping    = 0
+  };
+  model_bounds(model);
+}
+
+ModelStats model_stats(const Model* model) {
+  // FIFO cache: a vertex is resident while fewer than MODEL_CACHE_SIZE
+  // misses happened since its own, stamps count misses from 1
+  u32* stamp = (u32*)calloc(model->s_vertices, sizeof(u32));
+  assert(stamp != NULL);
+
+  u32 misses = 0;
+  for (u32 i = 0; i < model->s_indices; i++) {
+    const u32 v = model_index(model, i);
+    if (stamp[v] == 0 || misses - stamp[v] >= MODEL_CACHE_SIZE)
+      stamp[v] = ++misses;
+  }
+  free(stamp);
+
+  const u32 s_triangles = model->s_indices / 3;
+  return (ModelStats){
+    .s_vertices  = model->s_vertices,
+    .s_triangles = s_triangles,
+    .acmr        = s_triangles > 0 ? (f32)misses / s_triangles : 0.0f,
+    .bytes       = (u64)model->s_vertices * (sizeof(Vec3D) + sizeof(Color)) +
+                   (u64)model->s_indices * (model->indices16 != NULL ? sizeof(u16) : sizeof(u32))
+  };
+}
+
+#define INSTANCE_STREAMS 16
+
+static void instances_streams(Instances* instances, f32** streams[INSTANCE_STREAMS]) {
+  f32** fields[INSTANCE_STREAMS] = {
+    &instances->px, &instances->py, &instances->pz,
+    &instances->rx, &instances->ry, &instances->rz,
+    &instances->ux, &instances->uy, &instances->uz,
+    &instances->fx, &instances->fy, &instances->fz,
+    &instances->scale,
+    &instances->r,  &instances->g,  &instances->b
+  };
+  memcpy(streams, fields, sizeof(fields));
+}
+
+static void instances_grow(Instances* instances, const u32 capacity) {
+  f32** streams[INSTANCE_STREAMS];
+  instances_streams(instances, streams);
+
+  for (u32 s = 0; s < INSTANCE_STREAMS; s++) {
+    f32* stream = (f32*)realloc(*streams[s], capacity * sizeof(f32));
+    assert(stream != NULL);
+    *streams[s] = stream;
+  }
+  instances->capacity = capacity;
+}
+
+Instances* instances_create(const u32 capacity) {
+  Instances* instances = (Instances*)calloc(1, sizeof(struct instances));
+  assert(instances != NULL);
+
+  instances_grow(instances, capacity > 0 ? capacity : 1);
+  return instances;
+}
+
+void instances_reset(Instances* instances) {
+  instances->count = 0;
+}
+
+void instances_push(
+  Instances* instances, const Vec3D position,
+  const Vec3D right, const Vec3D up, const Vec3D forward,
+  const f32 scale, const Color tint
+) {
+  if (instances->count == instances->capacity)
+    instances_grow(instances, 2 * instances->capacity);
+
+  const u32 i = instances->count++;
+  instances->px[i] = position.x; instances->py[i] = position.y; instances->pz[i] = position.z;
+  instances->rx[i] = right.x;    instances->ry[i] = right.y;    instances->rz[i] = right.z;
+  instances->ux[i] = up.x;       instances->uy[i] = up.y;       instances->uz[i] = up.z;
+  instances->fx[i] = forward.x;  instances->fy[i] = forward.y;  instances->fz[i] = forward.z;
+  instances->scale[i] = scale;
+  instances->r[i] = tint.r;      instances->g[i] = tint.g;      instances->b[i] = tint.b;
+}
+
+// A Cube3D is model_cube scaled by its half edge
+void instances_push_cube(Instances* instances, const Cube3D* cube, const Color tint) {
+  instances_push(instances, cube->center, cube->right, cube->up, cube->forward, cube->half_s_edge, tint);
+}
+
+void instances_free(Instances* instances) {
+  if (instances == NULL)
+    return;
+
+  f32** streams[INSTANCE_STREAMS];
+  instances_streams(instances, streams);
+  for (u32 s = 0; s < INSTANCE_STREAMS; s++)
+    free(*streams[s]);
+  free(instances);
+}
+
+// Vertices gathered per batch transform in graphics_clipper
+#define CLIPPER_BATCH 1024
+// Vertices may lie this many half-viewports past the screen center before a
+// triangle is clipped geometrically; inside it the rasterizer's viewport
+// clamp trims the triangle for free.
+#define CLIPPER_GUARD_BAND 8.0f
+
+// Planes in clip space, kept where a * x + b * y + c * z + d * w >= 0
+struct clip_plane {
+  f32 a, b, c, d;
+};
+
+struct clip_vertex {
+  f32 x, y, z, w;
+  Color color;
+};
+
+enum clip_planes {
+  ClipNear,
+  ClipGuardLeft, ClipGuardRight, ClipGuardTop, ClipGuardBottom,
+  ClipScreenLeft, ClipScreenRight, ClipScreenTop, ClipScreenBottom,
+  ClipPlanes
+};
+
+// Near and guard-band planes are clipped against, screen planes only reject
+#define CLIP_MASK ((1u << ClipScreenLeft) - 1)
+
+static const struct clip_plane clip_planes[ClipPlanes] = {
+  [ClipNear]         = {  0.0f,  0.0f, -1.0f, 1.0f },
+  [ClipGuardLeft]    = {  1.0f,  0.0f,  0.0f, CLIPPER_GUARD_BAND },
+  [ClipGuardRight]   = { -1.0f,  0.0f,  0.0f, CLIPPER_GUARD_BAND },
+  [ClipGuardTop]     = {  0.0f, -1.0f,  0.0f, CLIPPER_GUARD_BAND },
+  [ClipGuardBottom]  = {  0.0f,  1.0f,  0.0f, CLIPPER_GUARD_BAND },
+  [ClipScreenLeft]   = {  1.0f,  0.0f,  0.0f, 1.0f },
+  [ClipScreenRight]  = { -1.0f,  0.0f,  0.0f, 1.0f },
+  [ClipScreenTop]    = {  0.0f, -1.0f,  0.0f, 1.0f },
+  [ClipScreenBottom] = {  0.0f,  1.0f,  0.0f, 1.0f }
+};
+
+static f32 clip_distance(const struct clip_plane p, const struct clip_vertex* v) {
+  return p.a * v->x + p.b * v->y + p.c * v->z + p.d * v->w;
+}
+
+// Sutherland-Hodgman step, attributes interpolate linearly in clip space
+static u32 clip_polygon(
+  const struct clip_vertex* in, const u32 s_in,
+  struct clip_vertex* out, const struct clip_plane plane
+) {
+  u32 s_out = 0;
+  for (u32 i = 0; i < s_in; i++) {
+    const struct clip_vertex
+      *a = &in[i],
+      *b = &in[(i + 1) % s_in];
+    const f32
+      da = clip_distance(plane, a),
+      db = clip_distance(plane, b);
+
+    if (da >= 0)
+      out[s_out++] = *a;
+    if ((da >= 0) != (db >= 0)) {
+      const f32 t = da / (da - db);
+      out[s_out++] = (struct clip_vertex){
+        .x = a->x + (b->x - a->x) * t,
+        .y = a->y + (b->y - a->y) * t,
+        .z = a->z + (b->z - a->z) * t,
+        .w = a->w + (b->w - a->w) * t,
+        .color = {
+          .r = a->color.r + (b->color.r - a->color.r) * t,
+          .g = a->color.g + (b->color.g - a->color.g) * t,
+          .b = a->color.b + (b->color.b - a->color.b) * t
+        }
+      };
+    }
+  }
+  return s_out;
+}
+
+// Post-transform vertex streams, allocated per model from the frame arena
+struct clipper_cache {
+  f32 *x, *y, *z, *w; // Clip space
+  f32 *sx, *sy;       // Normalized device coordinates with y down like the
+                      // screen, valid in front of the near plane
+  u32 *outcode;
+};
+
+static struct clipper_cache clipper_cache_alloc(Arena* arena, const u32 s_vertices) {
+  const u64 s_stream = s_vertices * sizeof(f32);
+  return (struct clipper_cache){
+    .x       = (f32*)arena_alloc(arena, s_stream),
+    .y       = (f32*)arena_alloc(arena, s_stream),
+    .z       = (f32*)arena_alloc(arena, s_stream),
+    .w       = (f32*)arena_alloc(arena, s_stream),
+    .sx      = (f32*)arena_alloc(arena, s_stream),
+    .sy      = (f32*)arena_alloc(arena, s_stream),
+    .outcode = (u32*)arena_alloc(arena, s_vertices * sizeof(u32))
+  };
+}
+
+static void clipper_push(
+  RenderQueueSoA* queue,
+  const struct clip_vertex* v1, const struct clip_vertex* v2, const struct clip_vertex* v3
+) {
+  graphics_queue_reserve(queue, 1);
+
+  u32 idx = queue->count;
+  queue->v1x[idx] = v1->x;       queue->v1y[idx] = v1->y;       queue->v1w[idx] = v1->w;
+  queue->v1r[idx] = v1->color.r; queue->v1g[idx] = v1->color.g; queue->v1b[idx] = v1->color.b;
+
+  queue->v2x[idx] = v2->x;       queue->v2y[idx] = v2->y;       queue->v2w[idx] = v2->w;
+  queue->v2r[idx] = v2->color.r; queue->v2g[idx] = v2->color.g; queue->v2b[idx] = v2->color.b;
+
+  queue->v3x[idx] = v3->x;       queue->v3y[idx] = v3->y;       queue->v3w[idx] = v3->w;
+  queue->v3r[idx] = v3->color.r; queue->v3g[idx] = v3->color.g; queue->v3b[idx] = v3->color.b;
+
+  queue->count++;
+}
+
+// Classifies and projects the clip space streams of the cache
+static void clipper_project(const struct clipper_cache* cache, const u32 s_vertices) {
+  for (u32 i = 0; i < s_vertices; i++) {
+    const struct clip_vertex v = { .x = cache->x[i], .y = cache->y[i], .z = cache->z[i], .w = cache->w[i] };
+
+    u32 outcode = 0;
+    for (u32 p = 0; p < ClipPlanes; p++)
+      if (clip_distance(clip_planes[p], &v) < 0)
+        outcode |= 1u << p;
+    cache->outcode[i] = outcode;
+
+    if (!(outcode & (1u << ClipNear))) {
+      cache->sx[i] =  v.x / v.w;
+      cache->sy[i] = -v.y / v.w;
+    }
+  }
+}
+
+// Assembles, culls and clips the model's triangles from the projected cache
+static void clipper_assemble(
+  const Model* model, const struct clipper_cache* cache, const Color tint,
+  RenderQueueSoA* queue
+) {
+  PROFILE_COUNT(ProfileTrianglesSubmitted, model->s_indices / 3);
+
+  for (u32 i = 0; i < model->s_indices; i += 3) {
+    const u32
+      i1 = model_index(model, i),
+      i2 = model_index(model, i + 1),
+      i3 = model_index(model, i + 2);
+    const u32
+      outside_all = cache->outcode[i1] & cache->outcode[i2] & cache->outcode[i3],
+      outside_any = cache->outcode[i1] | cache->outcode[i2] | cache->outcode[i3];
+
+    // Entirely behind the camera or off one side of the screen
+    if (outside_all) {
+      PROFILE_COUNT(ProfileTrianglesCulled, 1);
+      continue;
+    }
+
+    if (!(outside_any & (1u << ClipNear))) {
+      const f32 area =
+        (cache->sx[i2] - cache->sx[i1]) * (cache->sy[i3] - cache->sy[i1]) -
+        (cache->sy[i2] - cache->sy[i1]) * (cache->sx[i3] - cache->sx[i1]);
+      if (area >= 0 && !model->double_sided) {
+        PROFILE_COUNT(ProfileTrianglesCulled, 1);
+        continue;
+      }
+    }
+
+    struct clip_vertex v[3];
+    const u32 ids[3] = { i1, i2, i3 };
+    for (u32 j = 0; j < 3; j++) {
+      const Color color = model->colors[ids[j]];
+      v[j] = (struct clip_vertex){
+        .x = cache->x[ids[j]], .y = cache->y[ids[j]],
+        .z = cache->z[ids[j]], .w = cache->w[ids[j]],
+        .color = { color.r * tint.r, color.g * tint.g, color.b * tint.b }
+      };
+    }
+
+    if (!(outside_any & CLIP_MASK)) {
+      clipper_push(queue, &v[0], &v[1], &v[2]);
+      continue;
+    }
+
+    // Crossing the near plane, so cull on the homogeneous (x, y, w)
+    // determinant, which has the sign of the screen area without dividing
+    if ((outside_any & (1u << ClipNear)) && !model->double_sided) {
+      const f32 facing =
+        v[0].x * (v[1].y * v[2].w - v[1].w * v[2].y) +
+        v[0].y * (v[1].w * v[2].x - v[1].x * v[2].w) +
+        v[0].w * (v[1].x * v[2].y - v[1].y * v[2].x);
+      if (facing <= 0) {
+        PROFILE_COUNT(ProfileTrianglesCulled, 1);
+        continue;
+      }
+    }
+    PROFILE_COUNT(ProfileTrianglesClipped, 1);
+
+    // Each plane adds at most one vertex
+    struct clip_vertex
+      polygon[2][3 + ClipScreenLeft],
+      *in = polygon[0],
+      *out = polygon[1];
+    u32 s_polygon = 3;
+    in[0] = v[0]; in[1] = v[1]; in[2] = v[2];
+
+    for (u32 p = 0; p < ClipScreenLeft && s_polygon >= 3; p++) {
+      if (!(outside_any & (1u << p)))
+        continue;
+
+      s_polygon = clip_polygon(in, s_polygon, out, clip_planes[p]);
+      struct clip_vertex* t = in; in = out; out = t;
+    }
+
+    for (u32 j = 1; j + 1 < s_polygon; j++)
+      clipper_push(queue, &in[0], &in[j], &in[j + 1]);
+  }
+}
+
+// mvp takes the model to clip space, see geometry_camera_projection;
+// graphics_render maps the queue's clip coordinates to the viewport.
+//
+// Every vertex of the model is transformed, projected and classified once
+// into scratch streams in the queue's frame arena, then triangles are
+// assembled from them by index.
+// Front faces wind counter-clockwise on screen.
+void graphics_clipper(const Mat4* mvp, const Model* model, RenderQueueSoA* queue) {
+  graphics_clipper_tinted(mvp, model, ColorWhite, queue);
+}
+
+// The same with tint multiplied into the vertex colors
+void graphics_clipper_tinted(const Mat4* mvp, const Model* model, const Color tint, RenderQueueSoA* queue) {
+  const struct clipper_cache cache = clipper_cache_alloc(queue->arena, model->s_vertices);
+
+  f32 xs[CLIPPER_BATCH], ys[CLIPPER_BATCH], zs[CLIPPER_BATCH];
+  for (u32 start = 0; start < model->s_vertices; start += CLIPPER_BATCH) {
+    const u32 s_batch =
+      model->s_vertices - start < CLIPPER_BATCH ? model->s_vertices - start : CLIPPER_BATCH;
+
+    for (u32 k = 0; k < s_batch; k++) {
+      xs[k] = model->vertices[start + k].x;
+      ys[k] = model->vertices[start + k].y;
+      zs[k] = model->vertices[start + k].z;
+    }
+
+    geometry_mat4_transform_batch(
+      mvp, xs, ys, zs,
+      cache.x + start, cache.y + start, cache.z + start, cache.w + start, s_batch
+    );
+  }
+
+  clipper_project(&cache, model->s_vertices);
+  clipper_assemble(model, &cache, tint, queue);
+}
+
+// Draws the model once per instance. The model's vertices are split into
+// streams once, each instance's model matrix is folded into view_projection
+// so a vertex costs one matrix transform, and all instances reuse the same
+// cache, so no vertex data is copied per instance.
+void graphics_clipper_instanced(
+  const Mat4* view_projection, const Model* model, const Instances* instances,
+  RenderQueueSoA* queue
+) {
+  if (instances->count == 0)
+    return;
+
+  const u64 s_stream = model->s_vertices * sizeof(f32);
+  f32
+    *xs = (f32*)arena_alloc(queue->arena, s_stream),
+    *ys = (f32*)arena_alloc(queue->arena, s_stream),
+    *zs = (f32*)arena_alloc(queue->arena, s_stream),
+    radius = 0.0f;
+  for (u32 i = 0; i < model->s_vertices; i++) {
+    const Vec3D v = model->vertices[i];
+    xs[i] = v.x;
+    ys[i] = v.y;
+    zs[i] = v.z;
+    radius = fmaxf(radius, sqrtf(v.x * v.x + v.y * v.y + v.z * v.z));
+  }
+
+  const struct clipper_cache cache = clipper_cache_alloc(queue->arena, model->s_vertices);
+
+  for (u32 i = 0; i < instances->count; i++) {
+    const Mat4 placement = geometry_mat4_model(
+      (Vec3D){ instances->px[i], instances->py[i], instances->pz[i] },
+      (Vec3D){ instances->rx[i], instances->ry[i], instances->rz[i] },
+      (Vec3D){ instances->ux[i], instances->uy[i], instances->uz[i] },
+      (Vec3D){ instances->fx[i], instances->fy[i], instances->fz[i] },
+      instances->scale[i]
+    );
+    const Mat4 mvp = geometry_mat4_mul(view_projection, &placement);
+
+    // Whole instance behind the camera or off one side of the screen: each
+    // clip plane pulled back through mvp is a plane in model space, tested
+    // against the model's bounding sphere
+    bool outside = false;
+    for (u32 p = 0; p < ClipPlanes && !outside; p++) {
+      const struct clip_plane plane = clip_planes[p];
+      f32 n[4];
+      for (u32 c = 0; c < 4; c++)
+        n[c] = plane.a * mvp.m[0][c] + plane.b * mvp.m[1][c] + plane.c * mvp.m[2][c] + plane.d * mvp.m[3][c];
+      outside = n[3] < -radius * sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    }
+    if (outside) {
+      PROFILE_COUNT(ProfileTrianglesSubmitted, model->s_indices / 3);
+      PROFILE_COUNT(ProfileTrianglesCulled, model->s_indices / 3);
+      continue;
+    }
+
+    const Color tint = { instances->r[i], instances->g[i], instances->b[i] };
+
+    geometry_mat4_transform_batch(&mvp, xs, ys, zs, cache.x, cache.y, cache.z, cache.w, model->s_vertices);
+    clipper_project(&cache, model->s_vertices);
+    clipper_assemble(model, &cache, tint, queue);
+  }
+}
+
+void platform_build_model(const Camera* cam, Platform* platform) {
+  const f32 
+    sqrt_tiles  = sqrtf(platform->tiles),
+    tile_width  = platform->width / sqrt_tiles,
+    tile_length = platform->length / sqrt_tiles,
+    start_x = -platform->width / 2.0f,
+    start_z = -platform->length / 2.0f;
+  
+  const u32 tiles_per_side = (u32)sqrt_tiles;
+
+  platform->model = model_create(
+    4 * tiles_per_side * tiles_per_side,
+    6 * tiles_per_side * tiles_per_side
+  );
+  assert(platform->model != NULL);
+  
+  for (i32 row = tiles_per_side - 1; row >= 0; row--) {
+    for (i32 col = tiles_per_side - 1; col >= 0; col--) {
+      const f32 
+        x1 = start_x + col * tile_width,
+        x2 = start_x + (col + 1) * tile_width,
+        z1 = start_z + row * tile_length,
+        z2 = start_z + (row + 1) * tile_length,
+        y = 0.0f;
+      
+      const Vec3D corners[4] = {
+        { x1, y, z1 },
+        { x2, y, z1 },
+        { x2, y, z2 },
+        { x1, y, z2 }
+      };
+
+      const Color color = (row + col) % 2 ? ColorGray : ColorWhite;
+
+      const u32 index = 4 * (row * tiles_per_side + col);
+      platform->model->vertices[index]     = corners[0];
+      platform->model->vertices[index + 1] = corners[1];
+      platform->model->vertices[index + 2] = corners[2];
+      platform->model->vertices[index + 3] = corners[3];
+
+      for (u32 k = 0; k < 4; k++)
+        platform->model->colors[index + k] = color;
+
+      u32* indices = platform->model->indices + 6 * (row * tiles_per_side + col);
+      indices[0] = index;
+      indices[1] = index + 1;
+      indices[2] = index + 2;
+      indices[3] = index;
+      indices[4] = index + 2;
+      indices[5] = index + 3;
+    }
+  }
+  model_bounds(platform->model);
+}
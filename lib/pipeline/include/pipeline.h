@@ -0,0 +1,32 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "utils.h"
+#include "geometry.h"
+#include "arena.h"
+#include "graphics.h"
+
+// Fills a reset queue, whose arena is also reset, for one camera
+typedef void (*PipelineProduce)(void*, const Camera*, RenderQueueSoA*);
+
+// Two-stage frame pipeline: a producer thread builds the render queue of the
+// next frame while the caller rasterizes the current one. Frames go through
+// two slots, each with its own queue and frame arena:
+//
+//   pipeline_submit(pipeline, &camera_0);
+//   loop:
+//     pipeline_submit(pipeline, &camera_n+1);
+//     queue = pipeline_acquire(pipeline);  // Frame n
+//     graphics_render(window, queue); graphics_present(window);
+//     pipeline_release(pipeline);
+//
+// so the producer is never more than one frame ahead.
+typedef struct pipeline Pipeline;
+
+Pipeline*       pipeline_create  (PipelineProduce, void*, const u64, const u32);
+void            pipeline_submit  (Pipeline*, const Camera*);
+RenderQueueSoA* pipeline_acquire (Pipeline*);
+void            pipeline_release (Pipeline*);
+void            pipeline_free    (Pipeline*);
+
+#endif /* __PIPELINE_H__ */
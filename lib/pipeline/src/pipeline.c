@@ -0,0 +1,145 @@
+#include "pipeline.h"
+#include "profile.h"
+
+#include <stdatomic.h>
+
+#define PIPELINE_SLOTS 2
+
+struct pipeline_slot {
+  Camera camera;
+  Arena* arena;
+  RenderQueueSoA* queue;
+};
+
+// Each slot is owned by one side at a time and handed over through the
+// counting semaphores, which order the slot's writes before the other side
+// reads it; no lock guards the data. free starts at PIPELINE_SLOTS, the
+// others at 0, and every counter below is touched by a single thread.
+struct pipeline {
+  PipelineProduce produce;
+  void* user;
+
+  struct pipeline_slot slots[PIPELINE_SLOTS];
+  SDL_Semaphore
+    *free,      // Slots the caller may submit into
+    *submitted, // Slots with a camera for the producer
+    *produced;  // Slots with a queue for the caller
+  u64 s_submitted, s_produced, s_acquired;
+
+  SDL_Thread* thread; // NULL produces inline in pipeline_submit
+  atomic_bool quit;
+};
+
+static void pipeline_produce(Pipeline* pipeline, struct pipeline_slot* slot) {
+  arena_reset(slot->arena);
+  graphics_queue_reset(slot->queue);
+  pipeline->produce(pipeline->user, &slot->camera, slot->queue);
+}
+
+static int pipeline_worker(void* data) {
+  Pipeline* pipeline = (Pipeline*)data;
+
+  while (true) {
+    SDL_WaitSemaphore(pipeline->submitted);
+    if (atomic_load(&pipeline->quit))
+      break;
+
+    pipeline_produce(pipeline, &pipeline->slots[pipeline->s_produced++ % PIPELINE_SLOTS]);
+    SDL_SignalSemaphore(pipeline->produced);
+  }
+
+  return 0;
+}
+
+Pipeline* pipeline_create(
+  PipelineProduce produce, void* user,
+  const u64 s_arena, const u32 queue_capacity
+) {
+  assert(produce != NULL);
+
+  Pipeline* pipeline = (Pipeline*)malloc(sizeof(struct pipeline));
+  assert(pipeline != NULL);
+
+  *pipeline = (Pipeline){
+    .produce     = produce,
+    .user        = user,
+    .free        = SDL_CreateSemaphore(PIPELINE_SLOTS),
+    .submitted   = SDL_CreateSemaphore(0),
+    .produced    = SDL_CreateSemaphore(0),
+    .s_submitted = 0,
+    .s_produced  = 0,
+    .s_acquired  = 0
+  };
+  assert(pipeline->free != NULL && pipeline->submitted != NULL && pipeline->produced != NULL);
+  atomic_init(&pipeline->quit, false);
+
+  for (u32 s = 0; s < PIPELINE_SLOTS; s++) {
+    pipeline->slots[s].arena = arena_create(s_arena);
+    pipeline->slots[s].queue = graphics_queue_create(pipeline->slots[s].arena, queue_capacity);
+  }
+
+  pipeline->thread = SDL_CreateThread(pipeline_worker, "pipeline", pipeline);
+  if (pipeline->thread == NULL)
+    fprintf(stderr, "SDL_CreateThread failed: %s\n", SDL_GetError());
+
+  return pipeline;
+}
+
+// Blocks while both slots are in use, which bounds the producer to one
+// frame ahead of the frame being rendered.
+void pipeline_submit(Pipeline* pipeline, const Camera* camera) {
+  PROFILE_ZONE_BEGIN("pipeline_submit");
+  SDL_WaitSemaphore(pipeline->free);
+  PROFILE_ZONE_END("pipeline_submit");
+
+  struct pipeline_slot* slot = &pipeline->slots[pipeline->s_submitted++ % PIPELINE_SLOTS];
+  slot->camera = *camera;
+
+  if (pipeline->thread == NULL) {
+    pipeline_produce(pipeline, slot);
+    SDL_SignalSemaphore(pipeline->produced);
+    return;
+  }
+  SDL_SignalSemaphore(pipeline->submitted);
+}
+
+// Oldest submitted frame's queue, valid until pipeline_release
+RenderQueueSoA* pipeline_acquire(Pipeline* pipeline) {
+  PROFILE_ZONE_BEGIN("pipeline_acquire");
+  SDL_WaitSemaphore(pipeline->produced);
+  PROFILE_ZONE_END("pipeline_acquire");
+
+  return pipeline->slots[pipeline->s_acquired % PIPELINE_SLOTS].queue;
+}
+
+void pipeline_release(Pipeline* pipeline) {
+  pipeline->s_acquired++;
+  SDL_SignalSemaphore(pipeline->free);
+}
+
+// Frames submitted but never acquired are dropped
+void pipeline_free(Pipeline* pipeline) {
+  if (pipeline == NULL)
+    return;
+
+  if (pipeline->thread != NULL) {
+    atomic_store(&pipeline->quit, true);
+    SDL_SignalSemaphore(pipeline->submitted);
+    SDL_WaitThread(pipeline->thread, NULL);
+  }
+
+  for (u32 s = 0; s < PIPELINE_SLOTS; s++) {
+#ifdef DEBUG
+    fprintf(
+      stderr, "pipeline slot %u arena high-water mark: %llu bytes\n",
+      s, (unsigned long long)arena_high_water(pipeline->slots[s].arena)
+    );
+#endif
+    graphics_queue_free(pipeline->slots[s].queue);
+    arena_free(pipeline->slots[s].arena);
+  }
+  SDL_DestroySemaphore(pipeline->free);
+  SDL_DestroySemaphore(pipeline->submitted);
+  SDL_DestroySemaphore(pipeline->produced);
+  free(pipeline);
+}
@@ -0,0 +1,42 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include "utils.h"
+#include "graphics.h"
+
+// Zones and counters cost nothing unless the build defines PROFILE
+#ifdef PROFILE
+#define PROFILE_ZONE_BEGIN(name)  profile_begin(name)
+#define PROFILE_ZONE_END(name)    profile_end(name)
+#define PROFILE_COUNT(counter, n) profile_count(counter, n)
+#define PROFILE_FRAME()           profile_frame()
+#else
+#define PROFILE_ZONE_BEGIN(name)  ((void)0)
+#define PROFILE_ZONE_END(name)    ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+#define PROFILE_FRAME()           ((void)0)
+#endif
+
+// Events kept per thread; older ones are overwritten
+#define PROFILE_RING 65536
+
+typedef enum profile_counter {
+  ProfileTrianglesSubmitted,  // Entering the clipper
+  ProfileTrianglesClipped,    // Cut against the near plane or guard band
+  ProfileTrianglesCulled,     // Back-facing or entirely off screen
+  ProfileTrianglesRasterized, // Surviving triangle setup
+  ProfileModelsCulled,        // Outside the frustum before any vertex is transformed
+  ProfileModelsOccluded,      // Behind the occluders, likewise
+  ProfileCounters
+} ProfileCounter;
+
+void profile_begin         (const char*);
+void profile_end           (const char*);
+void profile_count         (const ProfileCounter, const u64);
+void profile_frame         (void);
+u32  profile_frame_index   (void);
+
+bool profile_export_chrome (const char*, const u32, const u32);
+void profile_draw_overlay  (Window*, const u32, const u32);
+
+#endif /* __PROFILE_H__ */
@@ -0,0 +1,286 @@
+#include "profile.h"
+
+#include <stdatomic.h>
+
+// Stages shown by the overlay, in the order they are first closed
+#define PROFILE_STAGES        16
+// Overlay bar length per millisecond
+#define PROFILE_OVERLAY_SCALE 20.0f
+
+enum profile_phase {
+  ProfilePhaseBegin,
+  ProfilePhaseEnd,
+  ProfilePhaseCounter
+};
+
+struct profile_event {
+  u64 ns;
+  const char* name;
+  u64 value; // Counter events only
+  u32 frame;
+  u8  phase;
+};
+
+// Only the owning thread writes a ring, and it publishes each event with a
+// release store of head, so recording never takes a lock. Readers see the
+// last PROFILE_RING events; the overlay reads the current frame while the
+// other threads record, export only once they are idle.
+// Rings are registered once per thread and live until exit.
+struct profile_ring {
+  struct profile_ring* next;
+  u32 tid;
+  atomic_ullong head;
+  struct profile_event events[PROFILE_RING];
+};
+
+struct profile_stage {
+  const char* name;
+  f64 ms;
+};
+
+static struct {
+  _Atomic(struct profile_ring*) rings;
+  atomic_uint threads;
+  atomic_uint frame;
+  atomic_ullong counters[ProfileCounters];
+
+  // Last finished frame, owned by the thread calling profile_frame
+  u64 totals[ProfileCounters];
+  struct profile_stage stages[PROFILE_STAGES];
+  u32 s_stages;
+} profile;
+
+static _Thread_local struct profile_ring* profile_local;
+
+static const char* const profile_counter_names[ProfileCounters] = {
+  [ProfileTrianglesSubmitted]  = "triangles submitted",
+  [ProfileTrianglesClipped]    = "triangles clipped",
+  [ProfileTrianglesCulled]     = "triangles culled",
+  [ProfileTrianglesRasterized] = "triangles rasterized",
+  [ProfileModelsCulled]        = "models culled",
+  [ProfileModelsOccluded]      = "models occluded"
+};
+
+// 3x5 glyphs for "0123456789.", top-left pixel in bit 14
+static const u16 profile_glyphs[11] = {
+  0x7b6f, 0x2c97, 0x73e7, 0x73cf, 0x5bc9, 0x79cf, 0x79ef, 0x7249, 0x7bef, 0x7bcf, 0x0002
+};
+
+static struct profile_ring*  profile_ring(void);
+static void                  profile_push(const char*, const u8, const u64);
+static void                  profile_ring_frame(struct profile_ring*, const u32, f64*);
+static struct profile_stage* profile_stage(const char*);
+static void                  profile_draw_text(Window*, const char*, const f32, const f32, const Color);
+
+void profile_begin(const char* name) {
+  profile_push(name, ProfilePhaseBegin, 0);
+}
+
+void profile_end(const char* name) {
+  profile_push(name, ProfilePhaseEnd, 0);
+}
+
+void profile_count(const ProfileCounter counter, const u64 n) {
+  atomic_fetch_add_explicit(&profile.counters[counter], n, memory_order_relaxed);
+}
+
+// Closes the frame: records the counters and sums the zones each thread
+// closed during it into the stage times the overlay shows. Stages running on
+// several threads at once, like the raster workers, show their busiest one.
+void profile_frame(void) {
+  const u32 frame = atomic_load_explicit(&profile.frame, memory_order_relaxed);
+
+  for (u32 c = 0; c < ProfileCounters; c++) {
+    profile.totals[c] = atomic_exchange_explicit(&profile.counters[c], 0, memory_order_relaxed);
+    profile_push(profile_counter_names[c], ProfilePhaseCounter, profile.totals[c]);
+  }
+
+  for (u32 i = 0; i < profile.s_stages; i++)
+    profile.stages[i].ms = 0.0;
+
+  f64 ms[PROFILE_STAGES];
+  for (struct profile_ring* ring = atomic_load(&profile.rings); ring != NULL; ring = ring->next) {
+    for (u32 i = 0; i < PROFILE_STAGES; i++)
+      ms[i] = 0.0;
+    profile_ring_frame(ring, frame, ms);
+    for (u32 i = 0; i < profile.s_stages; i++)
+      if (ms[i] > profile.stages[i].ms)
+        profile.stages[i].ms = ms[i];
+  }
+
+  atomic_fetch_add_explicit(&profile.frame, 1, memory_order_relaxed);
+}
+
+u32 profile_frame_index(void) {
+  return atomic_load_explicit(&profile.frame, memory_order_relaxed);
+}
+
+// Writes the events of frames first..last, inclusive, as Chrome trace-event
+// JSON, loadable in chrome://tracing or Perfetto.
+bool profile_export_chrome(const char* path, const u32 first, const u32 last) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return false;
+  }
+
+  static const char phases[] = {
+    [ProfilePhaseBegin]   = 'B',
+    [ProfilePhaseEnd]     = 'E',
+    [ProfilePhaseCounter] = 'C'
+  };
+
+  fprintf(file, "{\"traceEvents\": [");
+  bool first_event = true;
+  for (struct profile_ring* ring = atomic_load(&profile.rings); ring != NULL; ring = ring->next) {
+    const u64
+      head  = atomic_load_explicit(&ring->head, memory_order_acquire),
+      start = head > PROFILE_RING ? head - PROFILE_RING : 0;
+
+    for (u64 i = start; i < head; i++) {
+      const struct profile_event* event = &ring->events[i % PROFILE_RING];
+      if (event->frame < first || event->frame > last)
+        continue;
+
+      fprintf(
+        file, "%s\n  {\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u",
+        first_event ? "" : ",", event->name, phases[event->phase], event->ns / 1e3, ring->tid
+      );
+      if (event->phase == ProfilePhaseCounter)
+        fprintf(file, ", \"args\": {\"value\": %llu}", (unsigned long long)event->value);
+      fprintf(file, "}");
+      first_event = false;
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  if (ferror(file) || fclose(file) != 0) {
+    fprintf(stderr, "Failed to write %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+// One bar per stage, PROFILE_OVERLAY_SCALE pixels per millisecond, followed
+// by its time; then the frame's counters.
+void profile_draw_overlay(Window* window, const u32 x, const u32 y) {
+  static const Color palette[4] = { ColorRed, ColorGreen, ColorWhite, ColorGray };
+  const u32 line = 14;
+
+  f32 row = y;
+  char text[32];
+  for (u32 i = 0; i < profile.s_stages; i++, row += line) {
+    const Color color = palette[i % 4];
+    const f32 length = (f32)profile.stages[i].ms * PROFILE_OVERLAY_SCALE;
+
+    for (u32 k = 0; k < 10; k++)
+      graphics_draw_line_2d(window, (Line2D){
+        .start = { x, row + k },
+        .end   = { x + length, row + k }
+      }, color, 255);
+
+    snprintf(text, sizeof(text), "%.2f", profile.stages[i].ms);
+    profile_draw_text(window, text, x + length + 6.0f, row, color);
+  }
+
+  for (u32 c = 0; c < ProfileCounters; c++, row += line) {
+    snprintf(text, sizeof(text), "%llu", (unsigned long long)profile.totals[c]);
+    profile_draw_text(window, text, x, row, ColorWhite);
+  }
+}
+
+static struct profile_ring* profile_ring(void) {
+  if (profile_local != NULL)
+    return profile_local;
+
+  struct profile_ring* ring = (struct profile_ring*)malloc(sizeof(struct profile_ring));
+  assert(ring != NULL);
+
+  ring->tid = atomic_fetch_add(&profile.threads, 1);
+  atomic_init(&ring->head, 0);
+
+  ring->next = atomic_load(&profile.rings);
+  while (!atomic_compare_exchange_weak(&profile.rings, &ring->next, ring));
+
+  profile_local = ring;
+  return ring;
+}
+
+static void profile_push(const char* name, const u8 phase, const u64 value) {
+  struct profile_ring* ring = profile_ring();
+  const u64 head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+  ring->events[head % PROFILE_RING] = (struct profile_event){
+    .ns    = SDL_GetTicksNS(),
+    .name  = name,
+    .value = value,
+    .frame = atomic_load_explicit(&profile.frame, memory_order_relaxed),
+    .phase = phase
+  };
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Adds the zones the ring closed during frame to ms, by stage. Other threads
+// keep recording meanwhile, so only events published before the call count.
+static void profile_ring_frame(struct profile_ring* ring, const u32 frame, f64* ms) {
+  const u64 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  u64 start = head;
+  while (start > 0 && head - start < PROFILE_RING &&
+         ring->events[(start - 1) % PROFILE_RING].frame == frame)
+    start--;
+
+  const struct profile_event* open[PROFILE_STAGES];
+  u32 depth = 0;
+  for (u64 i = start; i < head; i++) {
+    const struct profile_event* event = &ring->events[i % PROFILE_RING];
+
+    if (event->phase == ProfilePhaseBegin && depth < PROFILE_STAGES)
+      open[depth++] = event;
+    else if (event->phase == ProfilePhaseEnd && depth > 0) {
+      const struct profile_event* begin = open[--depth];
+      struct profile_stage* stage = profile_stage(begin->name);
+      if (stage != NULL)
+        ms[stage - profile.stages] += (event->ns - begin->ns) / 1e6;
+    }
+  }
+}
+
+// Zone names are string literals, so stages match by pointer
+static struct profile_stage* profile_stage(const char* name) {
+  for (u32 i = 0; i < profile.s_stages; i++)
+    if (profile.stages[i].name == name)
+      return &profile.stages[i];
+
+  if (profile.s_stages == PROFILE_STAGES)
+    return NULL;
+
+  profile.stages[profile.s_stages] = (struct profile_stage){ .name = name, .ms = 0.0 };
+  return &profile.stages[profile.s_stages++];
+}
+
+// Digits and dots at twice the glyph size
+static void profile_draw_text(Window* window, const char* text, const f32 x, const f32 y, const Color color) {
+  Vec2D points[4 * 15];
+
+  f32 cx = x;
+  for (const char* c = text; *c != '\0'; c++, cx += 8.0f) {
+    if ((*c < '0' || *c > '9') && *c != '.')
+      continue;
+    const u16 glyph = *c == '.' ? profile_glyphs[10] : profile_glyphs[*c - '0'];
+
+    u32 s_points = 0;
+    for (u32 bit = 0; bit < 15; bit++) {
+      if (!(glyph & (1u << (14 - bit))))
+        continue;
+
+      const f32
+        px = cx + 2.0f * (bit % 3),
+        py = y + 2.0f * (bit / 3);
+      points[s_points++] = (Vec2D){ px, py };
+      points[s_points++] = (Vec2D){ px + 1.0f, py };
+      points[s_points++] = (Vec2D){ px, py + 1.0f };
+      points[s_points++] = (Vec2D){ px + 1.0f, py + 1.0f };
+    }
+    graphics_draw_points(window, points, s_points, color, 255);
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef __SCENE_H__
+#define __SCENE_H__
+
+#include "utils.h"
+#include "geometry.h"
+#include "graphics.h"
+#include "model.h"
+#include "bvh.h"
+
+// Parent of top level nodes, and the item of nodes without a model
+#define SCENE_NONE UINT32_MAX
+
+// Hierarchy of transforms over placed models. A node's world matrix is its
+// parent's world matrix times its own local one, and nodes with a model are
+// items of the scene's BVH placed by their world matrix.
+//
+//   const u32 body = scene_add(scene, SCENE_NONE, &placement, NULL, ColorWhite);
+//   const u32 arm  = scene_add(scene, body, &offset, model, ColorRed);
+//   scene_set_local(scene, body, &moved);  // Moves arm along
+//   scene_clip(scene, &view_projection, queue);
+//
+// Nodes are stored depth first, so every subtree is a contiguous run with
+// each parent ahead of its children, and world matrices are recomputed on
+// the next scene_update only for the subtrees of nodes set since the last
+// one. A scene where nothing moved costs nothing to update.
+typedef struct scene Scene;
+
+Scene* scene_create    (const u32);
+u32    scene_add       (Scene*, const u32, const Mat4*, const Model*, const Color);
+void   scene_set_local (Scene*, const u32, const Mat4*);
+u32    scene_update    (Scene*);
+Mat4   scene_world     (const Scene*, const u32);
+Bvh*   scene_bvh       (const Scene*);
+void   scene_clip      (Scene*, const Mat4*, RenderQueueSoA*);
+void   scene_free      (Scene*);
+
+#endif /* __SCENE_H__ */
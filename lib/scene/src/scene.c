@@ -0,0 +1,276 @@
+#include "scene.h"
+#include "profile.h"
+
+// Node data is indexed by position in depth first order; handles returned
+// by scene_add stay valid when nodes are reordered
+struct scene {
+  u32 s_nodes, c_nodes;
+  u32* parent;    // Position of the parent, SCENE_NONE for top level nodes
+  u32* s_subtree; // Nodes in the subtree rooted here, itself included
+  Mat4* local;
+  Mat4* world;
+  u32* item;      // In bvh, SCENE_NONE for nodes without a model
+  u32* handle;    // Of the node at each position
+  bool* dirty;
+  u32* position;  // Of each handle
+
+  u32 s_dirty;
+  u32* dirties;   // Handles set since the last update
+  // Nodes added since the last update sit at the end, after their parents
+  // but outside their parents' subtrees
+  bool stale;
+
+  Bvh* bvh;
+};
+
+static void scene_grow(Scene*);
+static void scene_sort(Scene*);
+static void scene_transform(Scene*, const u32);
+static i32  scene_compare(const void*, const void*);
+
+Scene* scene_create(const u32 capacity) {
+  Scene* scene = (Scene*)malloc(sizeof(struct scene));
+  assert(scene != NULL);
+
+  *scene = (Scene){
+    .s_nodes = 0,
+    .c_nodes = 0,
+    .s_dirty = 0,
+    .stale   = false,
+    .bvh     = bvh_create(capacity)
+  };
+  scene->c_nodes = capacity > 0 ? capacity : 1;
+  scene_grow(scene);
+
+  return scene;
+}
+
+// Adds a node under parent, or at the top level for SCENE_NONE, and returns
+// its handle. A NULL model only places the node's children.
+u32 scene_add(Scene* scene, const u32 parent, const Mat4* local, const Model* model, const Color tint) {
+  assert(parent == SCENE_NONE || parent < scene->s_nodes);
+
+  if (scene->s_nodes == scene->c_nodes) {
+    scene->c_nodes *= 2;
+    scene_grow(scene);
+  }
+
+  const u32
+    node = scene->s_nodes++,
+    position = node;
+  scene->parent[position]    = parent == SCENE_NONE ? SCENE_NONE : scene->position[parent];
+  scene->s_subtree[position] = 1;
+  scene->local[position]     = *local;
+  scene->world[position]     = *local;
+  scene->item[position]      = model == NULL ? SCENE_NONE : bvh_insert(scene->bvh, model, local, tint);
+  scene->handle[position]    = node;
+  scene->dirty[position]     = true;
+  scene->position[node]      = position;
+  scene->dirties[scene->s_dirty++] = node;
+
+  // A top level node at the end keeps the order depth first, a child does not
+  if (parent != SCENE_NONE)
+    scene->stale = true;
+
+  return node;
+}
+
+void scene_set_local(Scene* scene, const u32 node, const Mat4* local) {
+  assert(node < scene->s_nodes);
+
+  const u32 position = scene->position[node];
+  scene->local[position] = *local;
+  if (!scene->dirty[position]) {
+    scene->dirty[position] = true;
+    scene->dirties[scene->s_dirty++] = node;
+  }
+}
+
+// Recomputes the world matrices of the subtrees set since the last update,
+// each once however many of its nodes were set, and moves their items.
+// Returns the number of nodes recomputed.
+u32 scene_update(Scene* scene) {
+  if (scene->stale) {
+    PROFILE_ZONE_BEGIN("scene_sort");
+    scene_sort(scene);
+    PROFILE_ZONE_END("scene_sort");
+
+    for (u32 i = 0; i < scene->s_nodes; i++)
+      scene_transform(scene, i);
+    scene->s_dirty = 0;
+    scene->stale = false;
+    return scene->s_nodes;
+  }
+  if (scene->s_dirty == 0)
+    return 0;
+
+  // In depth first order, a subtree's root comes before any node inside it
+  u32* positions = scene->dirties;
+  for (u32 i = 0; i < scene->s_dirty; i++)
+    positions[i] = scene->position[scene->dirties[i]];
+  qsort(positions, scene->s_dirty, sizeof(u32), scene_compare);
+
+  u32
+    updated = 0,
+    end = 0;
+  for (u32 i = 0; i < scene->s_dirty; i++) {
+    const u32 root = positions[i];
+    if (root < end)
+      continue;
+
+    end = root + scene->s_subtree[root];
+    for (u32 n = root; n < end; n++)
+      scene_transform(scene, n);
+    updated += end - root;
+  }
+  scene->s_dirty = 0;
+
+  return updated;
+}
+
+// As of the last scene_update
+Mat4 scene_world(const Scene* scene, const u32 node) {
+  assert(node < scene->s_nodes);
+  return scene->world[scene->position[node]];
+}
+
+// For occluders and culling statistics; items are placed by the scene
+Bvh* scene_bvh(const Scene* scene) {
+  return scene->bvh;
+}
+
+void scene_clip(Scene* scene, const Mat4* view_projection, RenderQueueSoA* queue) {
+  scene_update(scene);
+  bvh_clip(scene->bvh, view_projection, queue);
+}
+
+void scene_free(Scene* scene) {
+  if (scene == NULL)
+    return;
+
+  free(scene->parent);
+  free(scene->s_subtree);
+  free(scene->local);
+  free(scene->world);
+  free(scene->item);
+  free(scene->handle);
+  free(scene->dirty);
+  free(scene->position);
+  free(scene->dirties);
+  bvh_free(scene->bvh);
+  free(scene);
+}
+
+// Resizes every array to c_nodes
+static void scene_grow(Scene* scene) {
+  const u32 c = scene->c_nodes;
+  scene->parent    = (u32*)realloc(scene->parent, c * sizeof(u32));
+  scene->s_subtree = (u32*)realloc(scene->s_subtree, c * sizeof(u32));
+  scene->local     = (Mat4*)realloc(scene->local, c * sizeof(Mat4));
+  scene->world     = (Mat4*)realloc(scene->world, c * sizeof(Mat4));
+  scene->item      = (u32*)realloc(scene->item, c * sizeof(u32));
+  scene->handle    = (u32*)realloc(scene->handle, c * sizeof(u32));
+  scene->dirty     = (bool*)realloc(scene->dirty, c * sizeof(bool));
+  scene->position  = (u32*)realloc(scene->position, c * sizeof(u32));
+  scene->dirties   = (u32*)realloc(scene->dirties, c * sizeof(u32));
+  assert(scene->parent != NULL && scene->s_subtree != NULL && scene->local != NULL && scene->world != NULL);
+  assert(scene->item != NULL && scene->handle != NULL && scene->dirty != NULL);
+  assert(scene->position != NULL && scene->dirties != NULL);
+}
+
+// Reorders the nodes depth first, children in the order they were added.
+// Parents always precede their children, so linking each node in front of
+// its parent's list from the back leaves every list in order.
+static void scene_sort(Scene* scene) {
+  const u32 n = scene->s_nodes;
+  u32
+    *first = (u32*)malloc(n * sizeof(u32)),
+    *next  = (u32*)malloc(n * sizeof(u32)),
+    *stack = (u32*)malloc((n + 1) * sizeof(u32)),
+    *order = (u32*)malloc(n * sizeof(u32)),
+    *moved = (u32*)malloc(n * sizeof(u32));
+  assert(first != NULL && next != NULL && stack != NULL && order != NULL && moved != NULL);
+
+  u32 top_level = SCENE_NONE;
+  for (u32 i = 0; i < n; i++)
+    first[i] = SCENE_NONE;
+  for (u32 i = n; i-- > 0;) {
+    u32* list = scene->parent[i] == SCENE_NONE ? &top_level : &first[scene->parent[i]];
+    next[i] = *list;
+    *list = i;
+  }
+
+  // A popped node's first child goes on top of its next sibling, so the
+  // whole subtree comes out before the sibling does
+  u32
+    s_stack = 0,
+    s_order = 0;
+  if (top_level != SCENE_NONE)
+    stack[s_stack++] = top_level;
+  while (s_stack > 0) {
+    const u32 i = stack[--s_stack];
+    moved[i] = s_order;
+    order[s_order++] = i;
+    if (next[i] != SCENE_NONE)
+      stack[s_stack++] = next[i];
+    if (first[i] != SCENE_NONE)
+      stack[s_stack++] = first[i];
+  }
+  assert(s_order == n);
+
+  u32
+    *parent = (u32*)malloc(n * sizeof(u32)),
+    *item   = (u32*)malloc(n * sizeof(u32)),
+    *handle = (u32*)malloc(n * sizeof(u32));
+  Mat4* local = (Mat4*)malloc(n * sizeof(Mat4));
+  assert(parent != NULL && item != NULL && handle != NULL && local != NULL);
+
+  for (u32 i = 0; i < n; i++) {
+    const u32 from = order[i];
+    parent[i] = scene->parent[from] == SCENE_NONE ? SCENE_NONE : moved[scene->parent[from]];
+    item[i]   = scene->item[from];
+    handle[i] = scene->handle[from];
+    local[i]  = scene->local[from];
+    scene->position[handle[i]] = i;
+  }
+  memcpy(scene->parent, parent, n * sizeof(u32));
+  memcpy(scene->item,   item,   n * sizeof(u32));
+  memcpy(scene->handle, handle, n * sizeof(u32));
+  memcpy(scene->local,  local,  n * sizeof(Mat4));
+
+  // Children come after their parents, so sizes gather from the back
+  for (u32 i = 0; i < n; i++)
+    scene->s_subtree[i] = 1;
+  for (u32 i = n; i-- > 0;)
+    if (scene->parent[i] != SCENE_NONE)
+      scene->s_subtree[scene->parent[i]] += scene->s_subtree[i];
+
+  free(first);
+  free(next);
+  free(stack);
+  free(order);
+  free(moved);
+  free(parent);
+  free(item);
+  free(handle);
+  free(local);
+}
+
+// Parents are transformed first, so their world matrices are current
+static void scene_transform(Scene* scene, const u32 n) {
+  const u32 parent = scene->parent[n];
+  scene->world[n] = parent == SCENE_NONE
+    ? scene->local[n]
+    : geometry_mat4_mul(&scene->world[parent], &scene->local[n]);
+  scene->dirty[n] = false;
+
+  if (scene->item[n] != SCENE_NONE)
+    bvh_move(scene->bvh, scene->item[n], &scene->world[n]);
+}
+
+static i32 scene_compare(const void* a, const void* b) {
+  const u32
+    x = *(const u32*)a,
+    y = *(const u32*)b;
+  return (x > y) - (x < y);
+}
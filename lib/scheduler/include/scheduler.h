@@ -0,0 +1,35 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include "utils.h"
+
+typedef enum pacing {
+  PacingUnlimited, // Next frame starts as soon as this one is presented
+  PacingTarget,    // Frames start at the target rate, sleeping then spinning
+  PacingVsync      // graphics_present blocks on the display's refresh
+} Pacing;
+
+// Frame pacing and a fixed simulation step, both on SDL_GetTicksNS. Each
+// frame runs scheduler_begin's number of steps of step_ns, then renders the
+// state interpolated by scheduler_alpha between the last two steps.
+typedef struct scheduler {
+  Pacing pacing;
+  u64 frame_ns;  // Target frame period under PacingTarget
+  u64 step_ns;   // Simulation step
+  u64 spin_ns;   // Tail of each wait that is spun, tracks sleep overshoot
+  u32 max_steps; // Steps per frame before elapsed time is dropped
+
+  u64 last;        // Start of the previous frame
+  u64 deadline;    // Start of the next frame under PacingTarget
+  u64 accumulator; // Elapsed time not yet simulated
+  u64 frames;
+} Scheduler;
+
+Scheduler* scheduler_create       (const u32, const u32, const Pacing);
+u32        scheduler_begin        (Scheduler*);
+f32        scheduler_step_seconds (const Scheduler*);
+f32        scheduler_alpha        (const Scheduler*);
+void       scheduler_wait         (Scheduler*);
+void       scheduler_free         (Scheduler*);
+
+#endif /* __SCHEDULER_H__ */
@@ -0,0 +1,102 @@
+#include "scheduler.h"
+
+// Initial spin window, a typical sleep overshoot
+#define SCHEDULER_SPIN_NS   (2 * SDL_NS_PER_MS)
+// Bounds of the spin window, so noisy sleeps cannot turn pacing into a busy loop
+#define SCHEDULER_SPIN_MIN  (250 * SDL_NS_PER_US)
+#define SCHEDULER_SPIN_MAX  (4 * SDL_NS_PER_MS)
+// A frame longer than this many steps is simulated as if it was this long
+#define SCHEDULER_MAX_STEPS 8
+
+// step_rate simulation steps per second; frame_rate frames per second under
+// PacingTarget, ignored otherwise
+Scheduler* scheduler_create(const u32 step_rate, const u32 frame_rate, const Pacing pacing) {
+  assert(step_rate > 0);
+  assert(pacing != PacingTarget || frame_rate > 0);
+
+  Scheduler* scheduler = (Scheduler*)malloc(sizeof(struct scheduler));
+  assert(scheduler != NULL);
+
+  const u64 now = SDL_GetTicksNS();
+  *scheduler = (Scheduler){
+    .pacing      = pacing,
+    .frame_ns    = frame_rate > 0 ? SDL_NS_PER_SECOND / frame_rate : 0,
+    .step_ns     = SDL_NS_PER_SECOND / step_rate,
+    .spin_ns     = SCHEDULER_SPIN_NS,
+    .max_steps   = SCHEDULER_MAX_STEPS,
+    .last        = now,
+    .deadline    = now,
+    .accumulator = 0,
+    .frames      = 0
+  };
+
+  return scheduler;
+}
+
+// Starts a frame: adds the time since the previous one to the simulation
+// and returns how many steps to run now.
+u32 scheduler_begin(Scheduler* scheduler) {
+  const u64 now = SDL_GetTicksNS();
+
+  // After a stall (a debugger, a dragged window) drop the backlog instead of
+  // simulating it in a burst
+  const u64 limit = scheduler->max_steps * scheduler->step_ns;
+  scheduler->accumulator += now - scheduler->last;
+  if (scheduler->accumulator > limit)
+    scheduler->accumulator = limit;
+  scheduler->last = now;
+
+  const u32 steps = (u32)(scheduler->accumulator / scheduler->step_ns);
+  scheduler->accumulator -= steps * scheduler->step_ns;
+  scheduler->frames++;
+
+  return steps;
+}
+
+f32 scheduler_step_seconds(const Scheduler* scheduler) {
+  return scheduler->step_ns / (f32)SDL_NS_PER_SECOND;
+}
+
+// How far the frame lies between the last two steps, in [0, 1)
+f32 scheduler_alpha(const Scheduler* scheduler) {
+  return scheduler->accumulator / (f32)scheduler->step_ns;
+}
+
+// Ends a frame. Under PacingTarget this sleeps until spin_ns before the next
+// frame's start, then spins the rest so the frame starts on time without
+// burning the whole wait. spin_ns follows the worst recent sleep overshoot.
+void scheduler_wait(Scheduler* scheduler) {
+  if (scheduler->pacing != PacingTarget)
+    return;
+
+  scheduler->deadline += scheduler->frame_ns;
+
+  u64 now = SDL_GetTicksNS();
+  // Late: restart the cadence here rather than shorten the next frames to
+  // catch up
+  if (now >= scheduler->deadline) {
+    scheduler->deadline = now;
+    return;
+  }
+
+  if (now + scheduler->spin_ns < scheduler->deadline) {
+    const u64 wake = scheduler->deadline - scheduler->spin_ns;
+    SDL_DelayNS(wake - now);
+
+    now = SDL_GetTicksNS();
+    const u64
+      overshoot = now > wake ? now - wake : 0,
+      decayed   = scheduler->spin_ns - scheduler->spin_ns / 16;
+    scheduler->spin_ns = overshoot > decayed ? overshoot : decayed;
+    if (scheduler->spin_ns < SCHEDULER_SPIN_MIN)
+      scheduler->spin_ns = SCHEDULER_SPIN_MIN;
+    if (scheduler->spin_ns > SCHEDULER_SPIN_MAX)
+      scheduler->spin_ns = SCHEDULER_SPIN_MAX;
+  }
+
+  while (SDL_GetTicksNS() < scheduler->deadline);
+}
+
+void scheduler_free(Scheduler* scheduler) {
+  free(scheduler);
+}
@@ -0,0 +1,31 @@
+#ifndef __TERRAIN_H__
+#define __TERRAIN_H__
+
+#include "utils.h"
+#include "geometry.h"
+#include "graphics.h"
+#include "model.h"
+#include "bvh.h"
+
+// Flat checkered floor split into square chunks. Each chunk is a shared
+// vertex grid built at its own level of detail, level L keeping every 2^L-th
+// vertex, and is rebuilt only when its level or a neighbor's changes.
+typedef struct terrain {
+  f32 width, length;
+  u32 tiles;        // Per side
+  u32 chunk_tiles;  // Per chunk side, a power of two dividing tiles
+  u32 chunks;       // Per side
+  u32 max_lod;
+  f32 lod_distance; // Level 0 up to this far from the camera, doubling per level
+
+  u8*     lods;     // Current level per chunk
+  Model** models;   // Per chunk, at its current level
+  Bvh*    bvh;      // Over the chunks, item i being models[i]
+} Terrain;
+
+Terrain* terrain_create (const f32, const f32, const u32, const u32);
+u32      terrain_update (Terrain*, const Camera*);
+void     terrain_clip   (const Terrain*, const Mat4*, RenderQueueSoA*);
+void     terrain_free   (Terrain*);
+
+#endif /* __TERRAIN_H__ */
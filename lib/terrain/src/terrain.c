@@ -0,0 +1,223 @@
+#include "terrain.h"
+
+// Marks chunks not built yet
+#define TERRAIN_LOD_NONE 0xff
+
+enum terrain_edges {
+  TerrainWest, TerrainEast, TerrainNorth, TerrainSouth,
+  TerrainEdges
+};
+
+static u8     terrain_lod(const Terrain*, const Camera*, const u32, const u32);
+static Model* terrain_build_chunk(const Terrain*, const u32, const u32, const u8, const u8[TerrainEdges]);
+
+Terrain* terrain_create(const f32 width, const f32 length, const u32 tiles, const u32 chunk_tiles) {
+  assert(chunk_tiles > 0 && (chunk_tiles & (chunk_tiles - 1)) == 0);
+  assert(tiles >= chunk_tiles && tiles % chunk_tiles == 0);
+
+  Terrain* terrain = (Terrain*)malloc(sizeof(struct terrain));
+  assert(terrain != NULL);
+
+  const u32 chunks = tiles / chunk_tiles;
+
+  u32 max_lod = 0;
+  while ((1u << max_lod) < chunk_tiles)
+    max_lod++;
+
+  u8* lods = (u8*)malloc(chunks * chunks * sizeof(u8));
+  Model** models = (Model**)calloc(chunks * chunks, sizeof(Model*));
+  assert(lods != NULL && models != NULL);
+  memset(lods, TERRAIN_LOD_NONE, chunks * chunks * sizeof(u8));
+
+  // Chunks are built in world space, so every placement is the identity
+  Bvh* bvh = bvh_create(chunks * chunks);
+  const Mat4 identity = geometry_mat4_identity();
+  for (u32 i = 0; i < chunks * chunks; i++)
+    bvh_insert(bvh, NULL, &identity, ColorWhite);
+
+  *terrain = (Terrain){
+    .width        = width,
+    .length       = length,
+    .tiles        = tiles,
+    .chunk_tiles  = chunk_tiles,
+    .chunks       = chunks,
+    .max_lod      = max_lod,
+    .lod_distance = width / chunks,
+    .lods         = lods,
+    .models       = models,
+    .bvh          = bvh
+  };
+
+  return terrain;
+}
+
+// Picks every chunk's level from the camera, then rebuilds the chunks whose
+// level changed and their neighbors, whose stitched edges depend on it.
+// Returns the number of chunks rebuilt.
+u32 terrain_update(Terrain* terrain, const Camera* cam) {
+  const u32
+    chunks = terrain->chunks,
+    s_chunks = chunks * chunks;
+
+  u8* lods = (u8*)malloc(s_chunks * sizeof(u8));
+  bool* dirty = (bool*)calloc(s_chunks, sizeof(bool));
+  assert(lods != NULL && dirty != NULL);
+
+  for (u32 z = 0; z < chunks; z++)
+    for (u32 x = 0; x < chunks; x++) {
+      const u32 chunk = z * chunks + x;
+      lods[chunk] = terrain_lod(terrain, cam, x, z);
+      if (lods[chunk] == terrain->lods[chunk])
+        continue;
+
+      dirty[chunk] = true;
+      if (x > 0)          dirty[chunk - 1] = true;
+      if (x + 1 < chunks) dirty[chunk + 1] = true;
+      if (z > 0)          dirty[chunk - chunks] = true;
+      if (z + 1 < chunks) dirty[chunk + chunks] = true;
+    }
+
+  u32 s_rebuilt = 0;
+  for (u32 z = 0; z < chunks; z++)
+    for (u32 x = 0; x < chunks; x++) {
+      const u32 chunk = z * chunks + x;
+      if (!dirty[chunk])
+        continue;
+
+      // Each edge follows the coarser of the two chunks sharing it
+      const u8 lod = lods[chunk];
+      u8 edges[TerrainEdges] = { lod, lod, lod, lod };
+      if (x > 0          && lods[chunk - 1] > lod)      edges[TerrainWest]  = lods[chunk - 1];
+      if (x + 1 < chunks && lods[chunk + 1] > lod)      edges[TerrainEast]  = lods[chunk + 1];
+      if (z > 0          && lods[chunk - chunks] > lod) edges[TerrainNorth] = lods[chunk - chunks];
+      if (z + 1 < chunks && lods[chunk + chunks] > lod) edges[TerrainSouth] = lods[chunk + chunks];
+
+      model_free(terrain->models[chunk]);
+      terrain->models[chunk] = terrain_build_chunk(terrain, x, z, lod, edges);
+      bvh_set_model(terrain->bvh, chunk, terrain->models[chunk]);
+      s_rebuilt++;
+    }
+
+  memcpy(terrain->lods, lods, s_chunks * sizeof(u8));
+  free(lods);
+  free(dirty);
+
+  return s_rebuilt;
+}
+
+// Only the chunks whose boxes reach into the view are clipped
+void terrain_clip(const Terrain* terrain, const Mat4* view_projection, RenderQueueSoA* queue) {
+  bvh_clip(terrain->bvh, view_projection, queue);
+}
+
+void terrain_free(Terrain* terrain) {
+  if (terrain == NULL)
+    return;
+
+  for (u32 i = 0; i < terrain->chunks * terrain->chunks; i++)
+    model_free(terrain->models[i]);
+  bvh_free(terrain->bvh);
+  free(terrain->models);
+  free(terrain->lods);
+  free(terrain);
+}
+
+// Level from the distance between the camera and the nearest point of the
+// chunk, so a chunk never gets coarser as the camera approaches any part of it
+static u8 terrain_lod(const Terrain* terrain, const Camera* cam, const u32 x, const u32 z) {
+  const f32
+    chunk_width  = terrain->width / terrain->chunks,
+    chunk_length = terrain->length / terrain->chunks,
+    x0 = -terrain->width / 2.0f + x * chunk_width,
+    z0 = -terrain->length / 2.0f + z * chunk_length,
+    dx = fmaxf(fmaxf(x0 - cam->position.x, cam->position.x - (x0 + chunk_width)), 0.0f),
+    dz = fmaxf(fmaxf(z0 - cam->position.z, cam->position.z - (z0 + chunk_length)), 0.0f),
+    distance = sqrtf(dx * dx + cam->position.y * cam->position.y + dz * dz);
+
+  u8 lod = 0;
+  for (f32 d = terrain->lod_distance; distance > d && lod < terrain->max_lod; d *= 2.0f)
+    lod++;
+  return lod;
+}
+
+// Grid of the chunk at its level. Along an edge shared with a coarser chunk
+// the vertices that chunk lacks are collapsed onto its previous vertex, so
+// both sides meet at the same vertices without T-junctions; the triangles
+// this makes degenerate are dropped.
+static Model* terrain_build_chunk(
+  const Terrain* terrain,
+  const u32 cx, const u32 cz,
+  const u8 lod, const u8 edges[TerrainEdges]
+) {
+  const u32
+    step  = 1u << lod,
+    cells = terrain->chunk_tiles / step,
+    pitch = cells + 1;
+  const f32
+    tile_width  = terrain->width / terrain->tiles,
+    tile_length = terrain->length / terrain->tiles,
+    start_x = -terrain->width / 2.0f,
+    start_z = -terrain->length / 2.0f;
+
+  Model* model = model_create(pitch * pitch, 6 * cells * cells);
+
+  for (u32 j = 0; j <= cells; j++)
+    for (u32 i = 0; i <= cells; i++) {
+      const u32
+        tx = cx * terrain->chunk_tiles + i * step,
+        tz = cz * terrain->chunk_tiles + j * step;
+
+      model->vertices[j * pitch + i] = (Vec3D){
+        start_x + tx * tile_width, 0.0f, start_z + tz * tile_length
+      };
+      // Coarser levels average the checker pattern, as a mipmap would
+      model->colors[j * pitch + i] = lod > 0
+        ? (Color){ .r = 0.75f, .g = 0.75f, .b = 0.75f }
+        : (tx + tz) % 2 ? ColorGray : ColorWhite;
+    }
+
+  u32 ratio[TerrainEdges];
+  for (u32 e = 0; e < TerrainEdges; e++)
+    ratio[e] = 1u << (edges[e] - lod);
+
+  u32 s_indices = 0;
+  for (u32 j = 0; j < cells; j++)
+    for (u32 i = 0; i < cells; i++) {
+      const u32 corners[4][2] = {
+        { i, j }, { i + 1, j }, { i + 1, j + 1 }, { i, j + 1 }
+      };
+
+      u32 index[4];
+      for (u32 k = 0; k < 4; k++) {
+        u32
+          vi = corners[k][0],
+          vj = corners[k][1];
+        if (vi == 0)     vj -= vj % ratio[TerrainWest];
+        if (vi == cells) vj -= vj % ratio[TerrainEast];
+        if (vj == 0)     vi -= vi % ratio[TerrainNorth];
+        if (vj == cells) vi -= vi % ratio[TerrainSouth];
+        index[k] = vj * pitch + vi;
+      }
+
+      const u32 triangles[2][3] = {
+        { index[0], index[1], index[2] },
+        { index[0], index[2], index[3] }
+      };
+      for (u32 t = 0; t < 2; t++) {
+        const u32
+          a = triangles[t][0],
+          b = triangles[t][1],
+          c = triangles[t][2];
+        if (a == b || b == c || a == c)
+          continue;
+
+        model->indices[s_indices++] = a;
+        model->indices[s_indices++] = b;
+        model->indices[s_indices++] = c;
+      }
+    }
+  model->s_indices = s_indices;
+  model_bounds(model);
+
+  return model;
+}
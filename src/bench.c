@@ -0,0 +1,563 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "utils.h"
+
+#include "geometry.c"
+#include "arena.c"
+#include "graphics.c"
+#include "model.c"
+#include "bvh.c"
+#include "scene.c"
+#include "terrain.c"
+#include "pipeline.c"
+#include "profile.c"
+
+// Renders fixed scenes into a headless window and prints frame statistics
+// as JSON on stdout:
+//
+//   bench [--frames N] [--threads N] [--width N] [--height N] [--dump DIR]
+//         [--mesh FILE] [--pipeline] [--sort] [--optimize]
+//
+// --dump writes the last frame of every scene as DIR/<scene>.ppm and .png.
+// --mesh adds a scene with an OBJ or binary mesh file, centered in view.
+// --pipeline clips each next frame on a second thread while the current one
+// is rasterized, as the engine does.
+// --sort draws every frame front to back, as the engine does.
+// --optimize runs model_optimize on every scene's model at load and prints
+// the statistics before and after on stderr.
+
+#define FRAME_ARENA (16 << 20)
+
+typedef struct bench_scene {
+  const char* name;
+  Model* model;
+  Camera camera;
+  f32 orbit; // The camera sways this far along x once over the run
+  Terrain* terrain; // Drawn instead of model when set, re-LODed every frame
+  Instances* instances; // Placements of model when set
+  Bvh* bvh; // Drawn instead of instances when set, built from them
+  bool walled; // Adds a wall of model in front of the camera as an occluder
+  Scene* hierarchy; // Drawn instead of model when set, groups of cubes of model
+  u32 groups; // Per side of hierarchy
+  f32 spin; // Radians each group of hierarchy turns per frame
+  Shading shading;
+  bool incremental; // Redraws only the tiles that changed
+  u8 overlay; // Alpha of a full-screen quad of overlay_color over each frame, 0 for none
+  Color overlay_color;
+  BlendMode overlay_blend;
+} BenchScene;
+
+static Platform bench_platform(const u32 tiles) {
+  Platform platform = {
+    .width  = 1000.f,
+    .length = 1000.f,
+    .tiles  = tiles
+  };
+  platform_build_model(NULL, &platform);
+  return platform;
+}
+
+// side * side cubes of half edge 1 on a grid, 4 units apart
+static Model* bench_cubes(const u32 side, const Vec3D center) {
+  static const u32 faces[6][4] = {
+    { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 },
+    { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 }
+  };
+  const Color palette[3] = { ColorRed, ColorGreen, ColorWhite };
+
+  Model* model = model_create(8 * side * side, 36 * side * side);
+  for (u32 row = 0; row < side; row++)
+    for (u32 col = 0; col < side; col++) {
+      const u32 cube = row * side + col;
+      const f32
+        cx = center.x + 4.0f * (col - (side - 1) / 2.0f),
+        cz = center.z + 4.0f * (row - (side - 1) / 2.0f);
+
+      for (u32 k = 0; k < 8; k++) {
+        model->vertices[8 * cube + k] = (Vec3D){
+          cx + (k & 1 ? 1.0f : -1.0f),
+          center.y + (k & 2 ? 1.0f : -1.0f),
+          cz + (k & 4 ? 1.0f : -1.0f)
+        };
+        model->colors[8 * cube + k] = palette[cube % 3];
+      }
+
+      u32* indices = model->indices + 36 * cube;
+      for (u32 f = 0; f < 6; f++, indices += 6) {
+        indices[0] = 8 * cube + faces[f][0];
+        indices[1] = 8 * cube + faces[f][1];
+        indices[2] = 8 * cube + faces[f][2];
+        indices[3] = 8 * cube + faces[f][0];
+        indices[4] = 8 * cube + faces[f][2];
+        indices[5] = 8 * cube + faces[f][3];
+      }
+    }
+  model_bounds(model);
+
+  return model;
+}
+
+// The layout of bench_cubes as placements of one cube
+static Instances* bench_cube_instances(const u32 side, const Vec3D center) {
+  const Color palette[3] = { ColorRed, ColorGreen, ColorWhite };
+
+  Instances* instances = instances_create(side * side);
+  for (u32 row = 0; row < side; row++)
+    for (u32 col = 0; col < side; col++) {
+      const Cube3D cube = {
+        .center = {
+          center.x + 4.0f * (col - (side - 1) / 2.0f),
+          center.y,
+          center.z + 4.0f * (row - (side - 1) / 2.0f)
+        },
+        .right   = { 1, 0, 0 },
+        .up      = { 0, 1, 0 },
+        .forward = { 0, 0, 1 },
+        .half_s_edge = 1.0f
+      };
+      instances_push_cube(instances, &cube, palette[(row * side + col) % 3]);
+    }
+
+  return instances;
+}
+
+// Cubes per side of a hierarchy group
+#define BENCH_GROUP_SIDE 8
+
+// Placement of a group of bench_hierarchy, turned by angle about its center
+static Mat4 bench_group(const u32 side, const u32 group, const f32 angle) {
+  const f32
+    span = 4.0f * BENCH_GROUP_SIDE,
+    c = cosf(angle),
+    s = sinf(angle);
+  const Vec3D center = {
+    span * (group % side - (side - 1) / 2.0f),
+    1.0f,
+    span * (group / side - (side - 1) / 2.0f)
+  };
+  return geometry_mat4_model(center, (Vec3D){ c, 0, -s }, (Vec3D){ 0, 1, 0 }, (Vec3D){ s, 0, c }, 1.0f);
+}
+
+// The layout of bench_cubes(side * BENCH_GROUP_SIDE) as side * side group
+// nodes, each the parent of its cubes. Groups are added first, so group g
+// is node g.
+static Scene* bench_hierarchy(const u32 side, const Model* cube) {
+  const Color palette[3] = { ColorRed, ColorGreen, ColorWhite };
+  const u32 s_cubes = BENCH_GROUP_SIDE * BENCH_GROUP_SIDE;
+
+  Scene* scene = scene_create(side * side * (s_cubes + 1));
+  for (u32 g = 0; g < side * side; g++) {
+    const Mat4 placement = bench_group(side, g, 0.0f);
+    scene_add(scene, SCENE_NONE, &placement, NULL, ColorWhite);
+  }
+  for (u32 g = 0; g < side * side; g++)
+    for (u32 i = 0; i < s_cubes; i++) {
+      const Vec3D offset = {
+        4.0f * (i % BENCH_GROUP_SIDE - (BENCH_GROUP_SIDE - 1) / 2.0f),
+        0.0f,
+        4.0f * (i / BENCH_GROUP_SIDE - (BENCH_GROUP_SIDE - 1) / 2.0f)
+      };
+      const Mat4 local = geometry_mat4_model(offset, (Vec3D){ 1, 0, 0 }, (Vec3D){ 0, 1, 0 }, (Vec3D){ 0, 0, 1 }, 1.0f);
+      const u32
+        row = g / side * BENCH_GROUP_SIDE + i / BENCH_GROUP_SIDE,
+        col = g % side * BENCH_GROUP_SIDE + i % BENCH_GROUP_SIDE;
+      scene_add(scene, g, &local, cube, palette[(row * side * BENCH_GROUP_SIDE + col) % 3]);
+    }
+  scene_update(scene);
+
+  return scene;
+}
+
+// Latitude-longitude sphere, 2 * rings * segments triangles
+static Model* bench_sphere(const u32 rings, const u32 segments, const Vec3D center, const f32 radius) {
+  Model* model = model_create((rings + 1) * (segments + 1), 6 * rings * segments);
+
+  for (u32 r = 0; r <= rings; r++) {
+    const f32 theta = M_PI * r / rings;
+    for (u32 s = 0; s <= segments; s++) {
+      const f32 phi = 2.0f * M_PI * s / segments;
+      const u32 v = r * (segments + 1) + s;
+      model->vertices[v] = (Vec3D){
+        center.x + radius * sinf(theta) * cosf(phi),
+        center.y + radius * cosf(theta),
+        center.z + radius * sinf(theta) * sinf(phi)
+      };
+      model->colors[v] = (r + s) % 2 ? ColorGray : ColorWhite;
+    }
+  }
+
+  u32* indices = model->indices;
+  for (u32 r = 0; r < rings; r++)
+    for (u32 s = 0; s < segments; s++, indices += 6) {
+      const u32
+        a = r * (segments + 1) + s,
+        b = a + segments + 1;
+      indices[0] = a;
+      indices[1] = b + 1;
+      indices[2] = a + 1;
+      indices[3] = a;
+      indices[4] = b;
+      indices[5] = b + 1;
+    }
+  model_bounds(model);
+
+  return model;
+}
+
+static i32 bench_compare(const void* a, const void* b) {
+  const u64
+    x = *(const u64*)a,
+    y = *(const u64*)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples, in milliseconds
+static f64 bench_percentile(const u64* sorted, const u32 s_sorted, const f64 p) {
+  u32 rank = (u32)ceil(p * s_sorted);
+  if (rank > 0)
+    rank--;
+  return sorted[rank] / 1e6;
+}
+
+struct bench_frame {
+  const BenchScene* scene;
+  f32 aspect;
+  bool sorted;
+  u32 step;       // Frames clipped, which drive the scene's animation
+  u64 transforms; // World matrices recomputed by the scene's hierarchy
+};
+
+static Camera bench_camera(const BenchScene* scene, const u32 frame, const u32 frames) {
+  Camera camera = scene->camera;
+  camera.position.x += scene->orbit * sinf(2.0f * M_PI * frame / frames);
+  return camera;
+}
+
+// Culling counts of the scene's BVH, zero for scenes without one
+static BvhStats bench_models(const BenchScene* scene) {
+  if (scene->bvh != NULL)
+    return bvh_stats(scene->bvh);
+  if (scene->hierarchy != NULL)
+    return bvh_stats(scene_bvh(scene->hierarchy));
+  if (scene->terrain != NULL)
+    return bvh_stats(scene->terrain->bvh);
+  return (BvhStats){ 0 };
+}
+
+// Two triangles covering the window, blended over whatever was rendered
+static void bench_overlay(Window* window, const BenchScene* scene) {
+  const f32
+    w = (f32)window->width,
+    h = (f32)window->height;
+  const Triangle2D quad[2] = {
+    { { 0, 0 }, { 0, h }, { w, h } },
+    { { 0, 0 }, { w, h }, { w, 0 } }
+  };
+
+  graphics_set_blend(window, scene->overlay_blend);
+  graphics_draw_triangles_2d(window, quad, 2, scene->overlay_color, scene->overlay_color, scene->overlay);
+  graphics_set_blend(window, BlendOver);
+}
+
+static void bench_clip(void* user, const Camera* camera, RenderQueueSoA* queue) {
+  struct bench_frame* frame = (struct bench_frame*)user;
+  const BenchScene* scene = frame->scene;
+
+  const Mat4 view_projection = geometry_camera_view_projection(camera, frame->aspect);
+  if (scene->terrain != NULL) {
+    terrain_update(scene->terrain, camera);
+    terrain_clip(scene->terrain, &view_projection, queue);
+  } else if (scene->hierarchy != NULL) {
+    for (u32 g = 0; scene->spin != 0.0f && g < scene->groups * scene->groups; g++) {
+      const Mat4 placement = bench_group(scene->groups, g, scene->spin * frame->step);
+      scene_set_local(scene->hierarchy, g, &placement);
+    }
+    frame->transforms += scene_update(scene->hierarchy);
+    scene_clip(scene->hierarchy, &view_projection, queue);
+  } else if (scene->bvh != NULL)
+    bvh_clip(scene->bvh, &view_projection, queue);
+  else if (scene->instances != NULL)
+    graphics_clipper_instanced(&view_projection, scene->model, scene->instances, queue);
+  else
+    graphics_clipper(&view_projection, scene->model, queue);
+
+  if (frame->sorted)
+    graphics_queue_sort(queue, SortFrontToBack);
+  frame->step++;
+}
+
+static void bench_run(
+  Window* window, const BenchScene* scene,
+  RenderQueueSoA* queue, const bool pipelined, const bool sorted,
+  const u32 frames, const char* dump, const bool last
+) {
+  u64* times = (u64*)malloc(frames * sizeof(u64));
+  assert(times != NULL);
+
+  struct bench_frame context = { .scene = scene, .aspect = graphics_aspect(window), .sorted = sorted };
+  const BvhStats models_before = bench_models(scene);
+  Pipeline* pipeline = NULL;
+  if (pipelined) {
+    pipeline = pipeline_create(bench_clip, &context, FRAME_ARENA, 4096);
+    const Camera first = bench_camera(scene, 0, frames);
+    pipeline_submit(pipeline, &first);
+  }
+
+  graphics_set_shading(window, scene->shading);
+  graphics_set_incremental(window, scene->incremental);
+
+  const GraphicsStats before = graphics_stats(window);
+
+  for (u32 frame = 0; frame < frames; frame++) {
+    const u64 start = SDL_GetTicksNS();
+
+    if (pipeline != NULL && frame + 1 < frames) {
+      const Camera next = bench_camera(scene, frame + 1, frames);
+      pipeline_submit(pipeline, &next);
+    }
+
+    graphics_clear(window, ColorBlue);
+
+    if (pipeline != NULL)
+      graphics_render(window, pipeline_acquire(pipeline));
+    else {
+      const Camera camera = bench_camera(scene, frame, frames);
+      arena_reset(queue->arena);
+      graphics_queue_reset(queue);
+      bench_clip(&context, &camera, queue);
+      graphics_render(window, queue);
+    }
+    if (scene->overlay > 0)
+      bench_overlay(window, scene);
+    graphics_present(window);
+
+    if (pipeline != NULL)
+      pipeline_release(pipeline);
+
+    times[frame] = SDL_GetTicksNS() - start;
+  }
+
+  pipeline_free(pipeline);
+
+  const GraphicsStats after = graphics_stats(window);
+  const BvhStats models_after = bench_models(scene);
+
+  u32 triangles = 0;
+  if (scene->terrain != NULL)
+    for (u32 i = 0; i < scene->terrain->chunks * scene->terrain->chunks; i++)
+      triangles += scene->terrain->models[i]->s_indices / 3;
+  else if (scene->instances != NULL)
+    triangles = scene->instances->count * (scene->model->s_indices / 3);
+  else if (scene->hierarchy != NULL)
+    triangles = scene->groups * scene->groups * BENCH_GROUP_SIDE * BENCH_GROUP_SIDE * (scene->model->s_indices / 3);
+  else
+    triangles = scene->model->s_indices / 3;
+
+  u64 total = 0;
+  for (u32 i = 0; i < frames; i++)
+    total += times[i];
+  qsort(times, frames, sizeof(u64), bench_compare);
+
+  const f64 seconds = total / 1e9;
+  printf(
+    "    {\"name\": \"%s\", \"model_triangles\": %u, "
+    "\"frame_ms\": {\"p50\": %.3f, \"p99\": %.3f, \"mean\": %.3f}, "
+    "\"triangles_per_sec\": %.0f, \"pixels_per_sec\": %.0f, \"tiles_per_frame\": %.1f, "
+    "\"models_per_frame\": {\"clipped\": %.1f, \"culled\": %.1f, \"occluded\": %.1f}, "
+    "\"transforms_per_frame\": %.1f}%s\n",
+    scene->name, triangles,
+    bench_percentile(times, frames, 0.50),
+    bench_percentile(times, frames, 0.99),
+    seconds * 1e3 / frames,
+    (after.triangles - before.triangles) / seconds,
+    (after.pixels - before.pixels) / seconds,
+    (f64)(after.tiles - before.tiles) / frames,
+    (f64)(models_after.clipped - models_before.clipped) / frames,
+    (f64)(models_after.culled - models_before.culled) / frames,
+    (f64)(models_after.occluded - models_before.occluded) / frames,
+    (f64)context.transforms / frames,
+    last ? "" : ","
+  );
+
+  if (dump != NULL) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.ppm", dump, scene->name);
+    graphics_save_ppm(window, path);
+    snprintf(path, sizeof(path), "%s/%s.png", dump, scene->name);
+    graphics_save_png(window, path);
+  }
+
+  free(times);
+}
+
+i32 main(const i32 argc, const char* argv[]) {
+  u32
+    frames  = 120,
+    threads = 0,
+    width   = 16 * 90,
+    height  = 9  * 90;
+  const char
+    *dump = NULL,
+    *mesh = NULL;
+  bool
+    pipelined = false,
+    sorted    = false,
+    optimize  = false;
+
+  for (i32 i = 1; i < argc; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "--frames") == 0)
+      frames = (u32)atoi(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0)
+      threads = (u32)atoi(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--width") == 0)
+      width = (u32)atoi(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--height") == 0)
+      height = (u32)atoi(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--dump") == 0)
+      dump = argv[++i];
+    else if (i + 1 < argc && strcmp(argv[i], "--mesh") == 0)
+      mesh = argv[++i];
+    else if (strcmp(argv[i], "--pipeline") == 0)
+      pipelined = true;
+    else if (strcmp(argv[i], "--sort") == 0)
+      sorted = true;
+    else if (strcmp(argv[i], "--optimize") == 0)
+      optimize = true;
+    else {
+      fprintf(
+        stderr, "usage: %s [--frames N] [--threads N] [--width N] [--height N] [--dump DIR] [--mesh FILE] [--pipeline] [--sort] [--optimize]\n",
+        argv[0]
+      );
+      return 1;
+    }
+  }
+  if (frames == 0 || width == 0 || height == 0)
+    return 1;
+
+  Window* window = graphics_init_headless(width, height);
+  if (threads > 0)
+    graphics_set_threads(window, threads);
+  graphics_set_depth(window, DepthTestLess, true);
+
+  const Camera camera = {
+    .position = { 0, 20, 0 },
+    .pitch = -0.8f,
+    .yaw = 0.0f,
+    .fov = M_PI / 3.0f,
+    .near_plane = 0.1f
+  };
+
+  const Platform platforms[] = {
+    bench_platform(100),
+    bench_platform(2500),
+    bench_platform(10000)
+  };
+
+  BenchScene scenes[19] = {
+    { "platform-100",   platforms[0].model, camera, 90.0f },
+    { "platform-2500",  platforms[1].model, camera, 90.0f },
+    { "platform-10000", platforms[2].model, camera, 90.0f },
+    { "cubes-16",       bench_cubes(16, (Vec3D){ 0, 1, 0 }), camera, 20.0f },
+    { "cubes-64",       bench_cubes(64, (Vec3D){ 0, 1, 0 }), camera, 20.0f },
+    { "cubes-64-instanced", model_cube(), camera, 20.0f, .instances = bench_cube_instances(64, (Vec3D){ 0, 1, 0 }) },
+    { "cubes-256-bvh",  model_cube(), camera, 20.0f, .instances = bench_cube_instances(256, (Vec3D){ 0, 1, 0 }), .bvh = bvh_create(256 * 256) },
+    { "cubes-256-walled", model_cube(), camera, 20.0f, .instances = bench_cube_instances(256, (Vec3D){ 0, 1, 0 }), .bvh = bvh_create(256 * 256), .walled = true },
+    { "cubes-64-hierarchy", model_cube(), camera, 20.0f, .groups = 8, .spin = 0.02f },
+    { "cubes-64-hierarchy-static", model_cube(), camera, 20.0f, .groups = 8 },
+    { "cubes-64-idle",  model_cube(), camera, 0.0f, .instances = bench_cube_instances(64, (Vec3D){ 0, 1, 0 }), .incremental = true },
+    { "sphere-256k",    bench_sphere(256, 512, (Vec3D){ 0, 0, 0 }, 12.0f), camera, 4.0f },
+    { "sphere-4k",      bench_sphere(32, 64, (Vec3D){ 0, 0, 0 }, 12.0f), camera, 4.0f },
+    { "sphere-4k-smooth", bench_sphere(32, 64, (Vec3D){ 0, 0, 0 }, 12.0f), camera, 4.0f, .shading = ShadingGouraud },
+    { "sphere-4k-overlay", bench_sphere(32, 64, (Vec3D){ 0, 0, 0 }, 12.0f), camera, 4.0f, .overlay = 128, .overlay_color = ColorRed },
+    { "sphere-4k-additive", bench_sphere(32, 64, (Vec3D){ 0, 0, 0 }, 12.0f), camera, 4.0f, .overlay = 96, .overlay_color = ColorGreen, .overlay_blend = BlendAdd },
+    { "sphere-4k-multiply", bench_sphere(32, 64, (Vec3D){ 0, 0, 0 }, 12.0f), camera, 4.0f, .overlay = 192, .overlay_color = ColorGray, .overlay_blend = BlendMultiply },
+    { "terrain-1m",     NULL, camera, 400.0f, .terrain = terrain_create(1000.f, 1000.f, 1024, 64) }
+  };
+  u32 s_scenes = 18;
+
+  // The wall stands 30 units ahead, 120 wide and 30 high, over the camera
+  const Mat4 wall = { .m = {
+    { 60.0f, 0.0f,  0.0f, 0.0f  },
+    { 0.0f,  15.0f, 0.0f, 15.0f },
+    { 0.0f,  0.0f,  1.0f, 30.0f },
+    { 0.0f,  0.0f,  0.0f, 1.0f  }
+  } };
+  for (u32 i = 0; i < s_scenes; i++) {
+    if (scenes[i].groups > 0)
+      scenes[i].hierarchy = bench_hierarchy(scenes[i].groups, scenes[i].model);
+    if (scenes[i].bvh == NULL)
+      continue;
+    bvh_insert_instances(scenes[i].bvh, scenes[i].model, scenes[i].instances);
+    if (scenes[i].walled)
+      bvh_set_occluder(scenes[i].bvh, bvh_insert(scenes[i].bvh, scenes[i].model, &wall, ColorGray), true);
+  }
+
+  if (mesh != NULL) {
+    const u64 start = SDL_GetTicksNS();
+    const u64 s_mesh = strlen(mesh);
+    Model* model = s_mesh > 4 && strcmp(mesh + s_mesh - 4, ".obj") == 0
+      ? model_load_obj(mesh)
+      : model_load_mesh(mesh);
+    if (model == NULL)
+      return 1;
+    fprintf(stderr, "loaded %s in %.1f ms\n", mesh, (SDL_GetTicksNS() - start) / 1e6);
+
+    // Frame its bounds the way sphere-256k frames a radius of 12
+    const Vec3D
+      lo = model->min,
+      hi = model->max;
+    const f32 scale = fmaxf(hi.x - lo.x, fmaxf(hi.y - lo.y, hi.z - lo.z)) / 24.0f;
+
+    Camera view = camera;
+    view.position = (Vec3D){
+      (lo.x + hi.x) / 2.0f + camera.position.x * scale,
+      (lo.y + hi.y) / 2.0f + camera.position.y * scale,
+      (lo.z + hi.z) / 2.0f + camera.position.z * scale
+    };
+    scenes[s_scenes++] = (BenchScene){ "mesh", model, view, 4.0f * scale };
+  }
+
+  for (u32 i = 0; optimize && i < s_scenes; i++) {
+    if (scenes[i].model == NULL)
+      continue;
+
+    const u64 start = SDL_GetTicksNS();
+    const ModelStats before = model_stats(scenes[i].model);
+    model_optimize(scenes[i].model);
+    const ModelStats after = model_stats(scenes[i].model);
+    fprintf(
+      stderr, "%s: %u -> %u vertices, ACMR %.3f -> %.3f, %.1f -> %.1f KiB in %.1f ms\n",
+      scenes[i].name, before.s_vertices, after.s_vertices, before.acmr, after.acmr,
+      before.bytes / 1024.0, after.bytes / 1024.0, (SDL_GetTicksNS() - start) / 1e6
+    );
+  }
+
+  Arena* frame = arena_create(FRAME_ARENA);
+  RenderQueueSoA* queue = graphics_queue_create(frame, 4096);
+
+  printf("{\n");
+  printf("  \"width\": %u, \"height\": %u, \"frames\": %u, \"threads\": %u, \"pipeline\": %s, \"sort\": %s,\n",
+    width, height, frames, window->pool.s_threads, pipelined ? "true" : "false", sorted ? "true" : "false");
+  printf("  \"scenes\": [\n");
+  for (u32 i = 0; i < s_scenes; i++)
+    bench_run(window, &scenes[i], queue, pipelined, sorted, frames, dump, i + 1 == s_scenes);
+  printf("  ]\n}\n");
+
+  graphics_queue_free(queue);
+  arena_free(frame);
+  for (u32 i = 0; i < s_scenes; i++)
+    if (scenes[i].terrain != NULL)
+      terrain_free(scenes[i].terrain);
+    else {
+      bvh_free(scenes[i].bvh);
+      scene_free(scenes[i].hierarchy);
+      instances_free(scenes[i].instances);
+      model_free(scenes[i].model);
+    }
+  graphics_close(window);
+
+  return 0;
+}
@@ -0,0 +1,449 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "utils.h"
+
+#include "geometry.c"
+
+// Times the geometry kernels over random inputs and compares every SIMD or
+// precomputed variant against its scalar reference, printing JSON on stdout:
+//
+//   geobench [--count N] [--reps N] [--warmup N] [--seed N] [--check]
+//
+// Each kernel runs warmup times untimed, then reps times; the median rep is
+// reported per element in nanoseconds and in time stamp counter cycles.
+// --check skips the timings. Exits with 1 when a variant is further from
+// its reference than its tolerance allows.
+
+// Inputs are uniform in [-GEOBENCH_RANGE, GEOBENCH_RANGE]
+#define GEOBENCH_RANGE 1000.0f
+// Output streams per element, the most any kernel writes
+#define GEOBENCH_STREAMS 4
+
+struct geobench_data {
+  u64 count;
+  f32 *xs, *ys, *zs;
+  Vec2D* points_2d;
+  Vec3D* points;
+  Vec3D* front; // points with z in [1, 1 + GEOBENCH_RANGE], for projections
+  Cube3D* cubes;
+
+  Camera camera;
+  CameraView view;
+  Mat4 view_matrix, view_projection;
+};
+
+// Kernels write stream s of element i to out[s * count + i]
+typedef struct geobench_kernel {
+  const char* name;
+  void (*run)(struct geobench_data*, f32*);
+  bool (*available)(void); // NULL when always available
+} GeobenchKernel;
+
+// A variant agrees with its reference when every value is within tolerance
+// ULPs, counted at the larger of the reference's magnitude and floor. The
+// floor keeps results that cancel to near zero from inputs of scale floor
+// from counting their rounding against the tiny result.
+typedef struct geobench_check {
+  const char* variant;
+  const char* reference;
+  u32 s_streams;
+  f64 tolerance;
+  f32 floor;
+} GeobenchCheck;
+
+static u64 geobench_state;
+
+// xorshift64*, so runs with a seed are reproducible across platforms
+static f32 geobench_random(void) {
+  geobench_state ^= geobench_state >> 12;
+  geobench_state ^= geobench_state << 25;
+  geobench_state ^= geobench_state >> 27;
+  const u64 bits = (geobench_state * 0x2545F4914F6CDD1Dull) >> 40;
+  return ((f32)bits / (f32)(1 << 24) * 2.0f - 1.0f) * GEOBENCH_RANGE;
+}
+
+static u64 geobench_cycles(void) {
+#ifdef GEOMETRY_X86
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static void geobench_vec2d_add(struct geobench_data* d, f32* out) {
+  for (u64 i = 0; i < d->count; i++) {
+    const Vec2D v = geometry_vec2d_add(d->points_2d[i], d->points_2d[i ^ 1]);
+    out[i] = v.x;
+    out[d->count + i] = v.y;
+  }
+}
+
+static void geobench_vec2d_mul(struct geobench_data* d, f32* out) {
+  for (u64 i = 0; i < d->count; i++) {
+    const Vec2D v = geometry_vec2d_mul(d->points_2d[i], d->xs[i]);
+    out[i] = v.x;
+    out[d->count + i] = v.y;
+  }
+}
+
+static void geobench_vec3d_add(struct geobench_data* d, f32* out) {
+  for (u64 i = 0; i < d->count; i++) {
+    const Vec3D v = geometry_vec3d_add(d->points[i], d->points[i ^ 1]);
+    out[i] = v.x;
+    out[d->count + i] = v.y;
+    out[2 * d->count + i] = v.z;
+  }
+}
+
+static void geobench_vec3d_mul(struct geobench_data* d, f32* out) {
+  for (u64 i = 0; i < d->count; i++) {
+    const Vec3D v = geometry_vec3d_mul(d->points[i], d->xs[i]);
+    out[i] = v.x;
+    out[d->count + i] = v.y;
+    out[2 * d->count + i] = v.z;
+  }
+}
+
+static void geobench_vec3d_to_2d(struct geobench_data* d, f32* out) {
+  const Vec3D
+    unit   = { 700.0f, 700.0f, 0.0f },
+    origin = { 720.0f, 405.0f, 0.0f };
+  for (u64 i = 0; i < d->count; i++) {
+    const Vec2D v = geometry_vec3d_to_2d(d->front[i], unit, origin);
+    out[i] = v.x;
+    out[d->count + i] = v.y;
+  }
+}
+
+static void geobench_camera_transform(struct geobench_data* d, f32* out) {
+  for (u64 i = 0; i < d->count; i++) {
+    const Vec3D v = geometry_camera_transform(&d->camera, d->points[i]);
+    out[i] = v.x;
+    out[d->count + i] = v.y;
+    out[2 * d->count + i] = v.z;
+  }
+}
+
+static void geobench_camera_view_transform(struct geobench_data* d, f32* out) {
+  for (u64 i = 0; i < d->count; i++) {
+    const Vec3D v = geometry_camera_view_transform(&d->view, d->points[i]);
+    out[i] = v.x;
+    out[d->count + i] = v.y;
+    out[2 * d->count + i] = v.z;
+  }
+}
+
+// The camera transform as the renderer applies it, one matrix over streams
+static void geobench_camera_view_matrix(struct geobench_data* d, f32* out) {
+  const u64 n = d->count;
+  geometry_mat4_transform_batch(&d->view_matrix, d->xs, d->ys, d->zs, out, out + n, out + 2 * n, out + 3 * n, n);
+}
+
+static void geobench_mat4_scalar(struct geobench_data* d, f32* out) {
+  const u64 n = d->count;
+  mat4_transform_scalar(&d->view_projection, d->xs, d->ys, d->zs, out, out + n, out + 2 * n, out + 3 * n, 0, n);
+}
+
+#ifdef GEOMETRY_X86
+static void geobench_mat4_sse(struct geobench_data* d, f32* out) {
+  const u64 n = d->count;
+  mat4_transform_sse(&d->view_projection, d->xs, d->ys, d->zs, out, out + n, out + 2 * n, out + 3 * n, n);
+}
+
+static void geobench_mat4_avx2(struct geobench_data* d, f32* out) {
+  const u64 n = d->count;
+  mat4_transform_avx2(&d->view_projection, d->xs, d->ys, d->zs, out, out + n, out + 2 * n, out + 3 * n, n);
+}
+
+static bool geobench_has_sse2(void) {
+  return SDL_HasSSE2();
+}
+
+static bool geobench_has_avx2(void) {
+  return SDL_HasAVX2();
+}
+#endif /* GEOMETRY_X86 */
+
+// Rotations run in place, so timed reps keep turning the same cubes
+static void geobench_cube_rotate(struct geobench_data* d, f32* out, void (*rotate)(Cube3D*, const f32, const f32)) {
+  for (u64 i = 0; i < d->count; i++) {
+    rotate(&d->cubes[i], d->xs[i], 1.0f / 120.0f);
+    out[i] = d->cubes[i].right.x;
+    out[d->count + i] = d->cubes[i].up.y;
+    out[2 * d->count + i] = d->cubes[i].forward.z;
+  }
+}
+
+static void geobench_cube_rotate_xy(struct geobench_data* d, f32* out) {
+  geobench_cube_rotate(d, out, geometry_cube_rotate_xy);
+}
+
+static void geobench_cube_rotate_yz(struct geobench_data* d, f32* out) {
+  geobench_cube_rotate(d, out, geometry_cube_rotate_yz);
+}
+
+static void geobench_cube_rotate_xz(struct geobench_data* d, f32* out) {
+  geobench_cube_rotate(d, out, geometry_cube_rotate_xz);
+}
+
+static const GeobenchKernel geobench_kernels[] = {
+  { "vec2d_add",             geobench_vec2d_add,             NULL },
+  { "vec2d_mul",             geobench_vec2d_mul,             NULL },
+  { "vec3d_add",             geobench_vec3d_add,             NULL },
+  { "vec3d_mul",             geobench_vec3d_mul,             NULL },
+  { "vec3d_to_2d",           geobench_vec3d_to_2d,           NULL },
+  { "camera_transform",      geobench_camera_transform,      NULL },
+  { "camera_view_transform", geobench_camera_view_transform, NULL },
+  { "camera_view_matrix",    geobench_camera_view_matrix,    NULL },
+  { "mat4_transform_scalar", geobench_mat4_scalar,           NULL },
+#ifdef GEOMETRY_X86
+  { "mat4_transform_sse",    geobench_mat4_sse,              geobench_has_sse2 },
+  { "mat4_transform_avx2",   geobench_mat4_avx2,             geobench_has_avx2 },
+#endif
+  { "cube_rotate_xy",        geobench_cube_rotate_xy,        NULL },
+  { "cube_rotate_yz",        geobench_cube_rotate_yz,        NULL },
+  { "cube_rotate_xz",        geobench_cube_rotate_xz,        NULL }
+};
+
+// The SIMD kernels keep the scalar order of operations, so they must match
+// exactly; the matrix path reassociates the camera transform and rounds
+// its translation separately, so it is held to a few ULPs at input scale.
+static const GeobenchCheck geobench_checks[] = {
+  { "camera_view_transform", "camera_transform",      3, 0.0, 0.0f },
+  { "camera_view_matrix",    "camera_transform",      3, 8.0, GEOBENCH_RANGE },
+#ifdef GEOMETRY_X86
+  { "mat4_transform_sse",    "mat4_transform_scalar", 4, 0.0, 0.0f },
+  { "mat4_transform_avx2",   "mat4_transform_scalar", 4, 0.0, 0.0f },
+#endif
+};
+
+#define GEOBENCH_KERNELS (sizeof(geobench_kernels) / sizeof(geobench_kernels[0]))
+#define GEOBENCH_CHECKS  (sizeof(geobench_checks) / sizeof(geobench_checks[0]))
+
+static const GeobenchKernel* geobench_kernel(const char* name) {
+  for (u32 i = 0; i < GEOBENCH_KERNELS; i++)
+    if (strcmp(geobench_kernels[i].name, name) == 0)
+      return &geobench_kernels[i];
+  return NULL;
+}
+
+static bool geobench_available(const GeobenchKernel* kernel) {
+  return kernel->available == NULL || kernel->available();
+}
+
+// Distance between two values in ULPs of the larger of |reference| and floor
+static f64 geobench_ulps(const f32 value, const f32 reference, const f32 floor) {
+  if (value == reference)
+    return 0.0;
+  if (isnan(value) || isnan(reference))
+    return INFINITY;
+
+  const f32 scale = fmaxf(fabsf(reference), floor);
+  const f64 ulp = (f64)nextafterf(scale, INFINITY) - scale;
+  return fabs((f64)value - reference) / ulp;
+}
+
+static i32 geobench_compare(const void* a, const void* b) {
+  const u64
+    x = *(const u64*)a,
+    y = *(const u64*)b;
+  return (x > y) - (x < y);
+}
+
+static void geobench_fill(struct geobench_data* d, const u64 count) {
+  d->count = count;
+  d->xs        = (f32*)malloc(count * sizeof(f32));
+  d->ys        = (f32*)malloc(count * sizeof(f32));
+  d->zs        = (f32*)malloc(count * sizeof(f32));
+  d->points_2d = (Vec2D*)malloc(count * sizeof(Vec2D));
+  d->points    = (Vec3D*)malloc(count * sizeof(Vec3D));
+  d->front     = (Vec3D*)malloc(count * sizeof(Vec3D));
+  d->cubes     = (Cube3D*)malloc(count * sizeof(Cube3D));
+  assert(d->xs != NULL && d->ys != NULL && d->zs != NULL);
+  assert(d->points_2d != NULL && d->points != NULL && d->front != NULL && d->cubes != NULL);
+
+  for (u64 i = 0; i < count; i++) {
+    d->xs[i] = geobench_random();
+    d->ys[i] = geobench_random();
+    d->zs[i] = geobench_random();
+    d->points[i]    = (Vec3D){ d->xs[i], d->ys[i], d->zs[i] };
+    d->points_2d[i] = (Vec2D){ d->xs[i], d->ys[i] };
+    d->front[i]     = (Vec3D){ d->xs[i], d->ys[i], 1.0f + fabsf(d->zs[i]) };
+    d->cubes[i] = (Cube3D){
+      .center  = d->points[i],
+      .right   = { 1, 0, 0 },
+      .up      = { 0, 1, 0 },
+      .forward = { 0, 0, 1 },
+      .half_s_edge = 1.0f
+    };
+  }
+
+  d->camera = (Camera){
+    .position = { geobench_random() / 10.0f, geobench_random() / 50.0f, geobench_random() / 10.0f },
+    .pitch = -0.8f,
+    .yaw = 0.3f,
+    .fov = M_PI / 3.0f,
+    .near_plane = 0.1f
+  };
+  d->view            = geometry_camera_view(&d->camera);
+  d->view_matrix     = geometry_camera_view_matrix(&d->camera);
+  d->view_projection = geometry_camera_view_projection(&d->camera, 16.0f / 9.0f);
+}
+
+static void geobench_free(struct geobench_data* d) {
+  free(d->xs);
+  free(d->ys);
+  free(d->zs);
+  free(d->points_2d);
+  free(d->points);
+  free(d->front);
+  free(d->cubes);
+}
+
+// Median of reps timed runs, after warmup untimed ones
+static void geobench_time(
+  const GeobenchKernel* kernel, struct geobench_data* d, f32* out,
+  const u32 warmup, const u32 reps, const bool last
+) {
+  u64
+    *ns     = (u64*)malloc(reps * sizeof(u64)),
+    *cycles = (u64*)malloc(reps * sizeof(u64));
+  assert(ns != NULL && cycles != NULL);
+
+  for (u32 i = 0; i < warmup; i++)
+    kernel->run(d, out);
+
+  for (u32 i = 0; i < reps; i++) {
+    const u64
+      start = SDL_GetTicksNS(),
+      tsc   = geobench_cycles();
+    kernel->run(d, out);
+    cycles[i] = geobench_cycles() - tsc;
+    ns[i]     = SDL_GetTicksNS() - start;
+  }
+  qsort(ns, reps, sizeof(u64), geobench_compare);
+  qsort(cycles, reps, sizeof(u64), geobench_compare);
+
+  printf(
+    "    {\"name\": \"%s\", \"ns_per_element\": %.3f, \"cycles_per_element\": %.3f, \"elements_per_sec\": %.0f}%s\n",
+    kernel->name,
+    (f64)ns[reps / 2] / d->count,
+    (f64)cycles[reps / 2] / d->count,
+    d->count / (ns[reps / 2] / 1e9),
+    last ? "" : ","
+  );
+
+  free(ns);
+  free(cycles);
+}
+
+// Runs the reference and the variant on the same inputs; false on a mismatch
+static bool geobench_check(
+  const GeobenchCheck* check, struct geobench_data* d,
+  f32* reference, f32* variant, const bool last
+) {
+  const GeobenchKernel
+    *r = geobench_kernel(check->reference),
+    *v = geobench_kernel(check->variant);
+  assert(r != NULL && v != NULL);
+
+  const u64 n = (u64)check->s_streams * d->count;
+  f64 max_ulps = 0.0;
+  u64 failed = 0;
+  if (geobench_available(v)) {
+    r->run(d, reference);
+    v->run(d, variant);
+    for (u64 i = 0; i < n; i++) {
+      const f64 ulps = geobench_ulps(variant[i], reference[i], check->floor);
+      if (ulps > max_ulps)
+        max_ulps = ulps;
+      if (ulps > check->tolerance)
+        failed++;
+    }
+  }
+
+  printf(
+    "    {\"variant\": \"%s\", \"reference\": \"%s\", \"available\": %s, "
+    "\"max_ulps\": %.2f, \"tolerance\": %.2f, \"mismatches\": %llu}%s\n",
+    check->variant, check->reference, geobench_available(v) ? "true" : "false",
+    max_ulps, check->tolerance, (unsigned long long)failed,
+    last ? "" : ","
+  );
+  if (failed > 0)
+    fprintf(stderr, "%s: %llu values beyond %.2f ULPs of %s\n",
+      check->variant, (unsigned long long)failed, check->tolerance, check->reference);
+
+  return failed == 0;
+}
+
+i32 main(const i32 argc, const char* argv[]) {
+  u64 count = 1 << 20;
+  u32
+    reps   = 15,
+    warmup = 3;
+  u64 seed = 0x5EED;
+  bool check_only = false;
+
+  for (i32 i = 1; i < argc; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "--count") == 0)
+      count = (u64)atoll(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--reps") == 0)
+      reps = (u32)atoi(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--warmup") == 0)
+      warmup = (u32)atoi(argv[++i]);
+    else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0)
+      seed = (u64)atoll(argv[++i]);
+    else if (strcmp(argv[i], "--check") == 0)
+      check_only = true;
+    else {
+      fprintf(stderr, "usage: %s [--count N] [--reps N] [--warmup N] [--seed N] [--check]\n", argv[0]);
+      return 1;
+    }
+  }
+  // Kernels pair element i with i ^ 1
+  if (count < 2 || reps == 0 || seed == 0)
+    return 1;
+  count &= ~1ull;
+
+  geobench_state = seed;
+  struct geobench_data data;
+  geobench_fill(&data, count);
+
+  f32
+    *reference = (f32*)malloc(GEOBENCH_STREAMS * count * sizeof(f32)),
+    *variant   = (f32*)malloc(GEOBENCH_STREAMS * count * sizeof(f32));
+  assert(reference != NULL && variant != NULL);
+
+  printf("{\n");
+  printf("  \"count\": %llu, \"reps\": %u, \"warmup\": %u, \"seed\": %llu,\n",
+    (unsigned long long)count, reps, warmup, (unsigned long long)seed);
+
+  // Checks first, before the in-place kernels have moved any inputs
+  bool ok = true;
+  printf("  \"checks\": [\n");
+  for (u32 i = 0; i < GEOBENCH_CHECKS; i++)
+    ok &= geobench_check(&geobench_checks[i], &data, reference, variant, i + 1 == GEOBENCH_CHECKS);
+  printf("  ]%s\n", check_only ? "" : ",");
+
+  if (!check_only) {
+    u32 s_available = 0;
+    for (u32 i = 0; i < GEOBENCH_KERNELS; i++)
+      s_available += geobench_available(&geobench_kernels[i]);
+
+    printf("  \"kernels\": [\n");
+    for (u32 i = 0, k = 0; i < GEOBENCH_KERNELS; i++)
+      if (geobench_available(&geobench_kernels[i]))
+        geobench_time(&geobench_kernels[i], &data, reference, warmup, reps, ++k == s_available);
+    printf("  ]\n");
+  }
+  printf("}\n");
+
+  free(reference);
+  free(variant);
+  geobench_free(&data);
+
+  return ok ? 0 : 1;
+}
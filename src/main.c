@@ -1,167 +1,76 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "utils.h"
 
 #include "geometry.c"
+#include "arena.c"
 #include "graphics.c"
-
-typedef struct model {
-  u32    s_vertices;
-  Vec3D* vertices;
-  u32    s_indices;
-  u32*   indices;
-  Color* colors; // maybe add vertex colors to add gradients
-} Model;
-
-Model* model_create(const u32 s_vertices, const u32 s_indices) {
-  assert(s_vertices > 0);
-
-  Model* model = (Model*)malloc(sizeof(struct model));
-  assert(model != NULL);
-
-  Vec3D* vertices = (Vec3D*)malloc(s_vertices * sizeof(struct vector3d));
-  assert(vertices != NULL);
-
-  u32* indices = (u32*)malloc(s_indices * sizeof(u32));
-  assert(indices != NULL);
-
-  Color* colors = (Color*)malloc(s_vertices * sizeof(struct color));
-  assert(colors != NULL);
-
-  *model = (Model){
-    .s_vertices = s_vertices,
-    .vertices   = vertices,
-    .s_indices  = s_indices,
-    .indices    = indices,
-    .colors     = colors
-  };
-
-  return model;
-}
-
-void model_free(Model* model) {
-  if (model == NULL)
-    return;
-
-  if (model->vertices != NULL)
-    free(model->vertices);
-  if (model->indices != NULL)
-    free(model->indices);
-  if (model->colors != NULL)
-    free(model->colors);
-
-  free(model);
-}
-
-void graphics_clipper(const Camera* cam, const Model* model, RenderQueueSoA* queue) {
-  const f32 near_plane = cam->near_plane;
-
-  for (u32 i = 0; i < model->s_indices; i += 3) {
-    const Vec3D 
-      v1 = geometry_camera_transform(cam, model->vertices[model->indices[i]]),
-      v2 = geometry_camera_transform(cam, model->vertices[model->indices[i + 1]]),
-      v3 = geometry_camera_transform(cam, model->vertices[model->indices[i + 2]]);
-
-    const Color 
-      c1 = model->vertex_colors[model->indices[i]],
-      c2 = model->vertex_colors[model->indices[i + 1]],
-      c3 = model->vertex_colors[model->indices[i + 2]];
-
-    // 2. Basic Clipping Check (Simple Discard for now)
-    // If all vertices are behind near plane, skip
-    if (v1.z < near_plane && v2.z < near_plane && v3.z < near_plane)
-      continue;
-
-    // 3. Push to SoA Queue
-    u32 idx = queue->count;
-    queue->v1x[idx] = v1.x; queue->v1y[idx] = v1.y; queue->v1z[idx] = v1.z;
-    queue->v1r[idx] = c1.r; queue->v1g[idx] = c1.g; queue->v1b[idx] = c1.b;
-    
-    queue->v2x[idx] = v2.x; queue->v2y[idx] = v2.y; queue->v2z[idx] = v2.z;
-    queue->v2r[idx] = c2.r; queue->v2g[idx] = c2.g; queue->v2b[idx] = c2.b;
-
-    queue->v3x[idx] = v3.x; queue->v3y[idx] = v3.y; queue->v3z[idx] = v3.z;
-    queue->v3r[idx] = c3.r; queue->v3g[idx] = c3.g; queue->v3b[idx] = c3.b;
-
-    queue->count++;
-  }
-}
-
-void graphics_render(
-  Window* window,
-  const Triangle3D* queue, const u32 s_queue,
-  const Vec3D unit_vector, const Vec3D origin
-) {
-  for (u32 i = 0; i < count; i++) {
-    const Triangle2D tri2d = {
-      .v1 = geometry_vec3d_to_2d(queue[i].vertices[0], unit_vector, origin),
-      .v2 = geometry_vec3d_to_2d(queue[i].vertices[1], unit_vector, origin),
-      .v3 = geometry_vec3d_to_2d(queue[i].vertices[2], unit_vector, origin)
-    };
-
-    graphics_draw_triangle_2d(window, tri2d, queue[i].color, queue[i].color, 255);
-  }
-}
-
-void event_poll(SDL_Event* event, bool* running) {
+#include "model.c"
+#include "bvh.c"
+#include "terrain.c"
+#include "scheduler.c"
+#include "pipeline.c"
+#include "profile.c"
+
+// Initial size of each pipeline slot's arena for per-frame transient data
+#define FRAME_ARENA (16 << 20)
+// Frames written to trace.json on exit in profiling builds
+#define TRACE_FRAMES 120
+// Simulation steps per second, independent of the frame rate
+#define STEP_RATE 120
+
+// Escape quits, space stops and resumes the camera
+void event_poll(SDL_Event* event, bool* running, bool* paused, bool* exposed) {
   while (SDL_PollEvent(event)) {
     if (event->type == SDL_EVENT_QUIT)
       *running = false;
 
+    if (event->type == SDL_EVENT_WINDOW_EXPOSED)
+      *exposed = true;
+
     if (event->type == SDL_EVENT_KEY_DOWN) {
       if (event->key.key == SDLK_ESCAPE)
         *running = false;
+      if (event->key.key == SDLK_SPACE)
+        *paused = !*paused;
     }
   }
 }
 
-typedef struct platform {
-  const f32 width, length;
-  const u32 tiles;
-  Model* model;
-} Platform;
-
-void platform_build_model(const Camera* cam, Platform* platform) {
-  const f32 
-    sqrt_tiles  = sqrtf(platform->tiles),
-    tile_width  = platform->width / sqrt_tiles,
-    tile_length = platform->length / sqrt_tiles,
-    start_x = -platform->width / 2.0f,
-    start_z = -platform->length / 2.0f;
-  
-  const u32 tiles_per_side = (u32)sqrt_tiles;
+// The camera circles the terrain once every 720 seconds
+static Vec3D camera_orbit(const f32 t) {
+  return (Vec3D){
+    90.f * sinf(M_PI / 360.0f * t),
+    20.f + 9.f * cosf(M_PI / 360.0f * t),
+    0.0f
+  };
+}
 
-  platform->model = model_create(
-    4 * tiles_per_side * tiles_per_side,
-    6 * tiles_per_side * tiles_per_side
-  );
-  assert(platform->model != NULL);
-  
-  for (i32 row = tiles_per_side - 1; row >= 0; row--) {
-    for (i32 col = tiles_per_side - 1; col >= 0; col--) {
-      const f32 
-        x1 = start_x + col * tile_width,
-        x2 = start_x + (col + 1) * tile_width,
-        z1 = start_z + row * tile_length,
-        z2 = start_z + (row + 1) * tile_length,
-        y = 0.0f;
-      
-      const Vec3D corners[4] = {
-        { x1, y, z1 },
-        { x2, y, z1 },
-        { x2, y, z2 },
-        { x1, y, z2 }
-      };
-
-      const u32 index = 4 * (row * tiles_per_side + col);
-      platform->model->vertices[index]     = corners[0];
-      platform->model->vertices[index + 1] = corners[1];
-      platform->model->vertices[index + 2] = corners[2];
-      platform->model->vertices[index + 3] = corners[3];
-    }
-  }
+struct scene {
+  Terrain* terrain;
+  f32 aspect;
+};
+
+// Runs on the pipeline's thread, one frame ahead of the one being rendered
+static void scene_produce(void* user, const Camera* camera, RenderQueueSoA* queue) {
+  struct scene* scene = (struct scene*)user;
+
+  PROFILE_ZONE_BEGIN("terrain_update");
+  terrain_update(scene->terrain, camera);
+  PROFILE_ZONE_END("terrain_update");
+
+  PROFILE_ZONE_BEGIN("graphics_clipper");
+  const Mat4 view_projection = geometry_camera_view_projection(camera, scene->aspect);
+  terrain_clip(scene->terrain, &view_projection, queue);
+  PROFILE_ZONE_END("graphics_clipper");
+
+  // Front to back, so nearer hills hide what is behind them before it is shaded
+  PROFILE_ZONE_BEGIN("graphics_queue_sort");
+  graphics_queue_sort(queue, SortFrontToBack);
+  PROFILE_ZONE_END("graphics_queue_sort");
 }
 
 i32 main(const i32 argc, const char* argv[]) {
@@ -169,53 +78,143 @@ i32 main(const i32 argc, const char* argv[]) {
     width  = 16 * 90,
     height = 9  * 90;
 
+  // engine [--fps N | --vsync | --unlimited], 60 fps by default
+  Pacing pacing = PacingTarget;
+  u32 fps = 60;
+  for (i32 i = 1; i < argc; i++) {
+    if (i + 1 < argc && strcmp(argv[i], "--fps") == 0 && atoi(argv[i + 1]) > 0)
+      fps = (u32)atoi(argv[++i]);
+    else if (strcmp(argv[i], "--vsync") == 0)
+      pacing = PacingVsync;
+    else if (strcmp(argv[i], "--unlimited") == 0)
+      pacing = PacingUnlimited;
+    else {
+      fprintf(stderr, "usage: %s [--fps N | --vsync | --unlimited]\n", argv[0]);
+      return 1;
+    }
+  }
+
   Window* window = graphics_init("Engine", width, height);
   if (window == NULL)
     return 1; 
 
+  graphics_set_depth(window, DepthTestLess, true);
+  graphics_set_incremental(window, true);
+  if (pacing == PacingVsync && !graphics_set_vsync(window, true))
+    pacing = PacingTarget;
+
   Camera camera = {
     .position = { 0, 20, 0 },
     .pitch = -0.8f, // -M_PI / 2.0f,
     .yaw = 0.0f,
-    .fov = M_PI / 3.0f
+    .fov = M_PI / 3.0f,
+    .near_plane = 0.1f
   };
 
-  const Vec3D 
-    origin = { width / 2.0f, height / 2.0f, .0f },
-    unit_vector = { 90, 90, 90 };
-
-  const Platform platform = {
-    .width  = 1000.f,
-    .length = 1000.f,
-    .tiles  = 100
+  // 1024 x 1024 tiles in chunks of 64 x 64
+  struct scene scene = {
+    .terrain = terrain_create(1000.f, 1000.f, 1024, 64),
+    .aspect  = graphics_aspect(window)
   };
 
-  platform_build_model(&camera, &platform);
+  // The next frame is clipped while this one is rasterized
+  Pipeline* pipeline = pipeline_create(scene_produce, &scene, FRAME_ARENA, 4096);
 
-  bool running = true;
+  bool
+    running = true,
+    paused  = false,
+    exposed = false;
   SDL_Event event;
 
-  f32 dt = 0.f;
+  Scheduler* scheduler = scheduler_create(STEP_RATE, fps, pacing);
+  const f32 step = scheduler_step_seconds(scheduler);
+
+  f32 t = 0.f;
+  Vec3D
+    previous = camera_orbit(t),
+    current  = previous;
+
+  camera.position = current;
+  pipeline_submit(pipeline, &camera);
+
+  // Frames submitted and not yet rendered. The terrain only changes with the
+  // camera, so a still camera submits nothing and, once the pipeline has
+  // drained, the loop only polls events and waits.
+  Camera submitted = camera;
+  u32 in_flight = 1;
+
   while (running) {
-    event_poll(&event, &running);
-    graphics_clear(window, ColorBlue);
+    const u32 steps = scheduler_begin(scheduler);
+
+    PROFILE_ZONE_BEGIN("event_poll");
+    event_poll(&event, &running, &paused, &exposed);
+    PROFILE_ZONE_END("event_poll");
+
+    for (u32 s = 0; s < steps; s++) {
+      previous = current;
+      if (paused)
+        continue;
+      t += step;
+      if (t >= 720.f)
+        t -= 720.f;
+      current = camera_orbit(t);
+    }
+
+    // Rendered between the last two steps, so motion is smooth at any rate
+    const f32 alpha = scheduler_alpha(scheduler);
+    camera.position.x = previous.x + (current.x - previous.x) * alpha;
+    camera.position.y = previous.y + (current.y - previous.y) * alpha;
+
+    if (exposed)
+      graphics_invalidate(window);
+    const bool moved = exposed || !geometry_camera_equal(&camera, &submitted);
+    exposed = false;
+    if (moved) {
+      pipeline_submit(pipeline, &camera);
+      submitted = camera;
+      in_flight++;
+    }
+
+    // While moving, one frame stays in flight so clipping overlaps rendering
+    if (in_flight == 2 || (in_flight == 1 && !moved)) {
+      PROFILE_ZONE_BEGIN("graphics_clear");
+      graphics_clear(window, ColorBlue);
+      PROFILE_ZONE_END("graphics_clear");
+
+      RenderQueueSoA* queue = pipeline_acquire(pipeline);
 
-    camera.position.x = unit_vector.x * sinf(M_PI / 360.0f * dt);
-    camera.position.y = 20.f + 0.10 * unit_vector.y * cosf(M_PI / 360.0f * dt);
+      PROFILE_ZONE_BEGIN("graphics_render");
+      graphics_render(window, queue);
+      PROFILE_ZONE_END("graphics_render");
 
-    dt += 0.016f;
-    if (dt >= 720.f)
-      dt = 0;
+#ifdef PROFILE
+      profile_draw_overlay(window, 10, 10);
+#endif
 
-    graphics_clipper(camera, models, s_models);
+      PROFILE_ZONE_BEGIN("graphics_present");
+      graphics_present(window);
+      PROFILE_ZONE_END("graphics_present");
 
-    for (u32 i = 0; i < s_models; i++)
-      graphics_render(window, &models[i], unit_vector, origin);
+      pipeline_release(pipeline);
+      in_flight--;
+    }
+
+    PROFILE_ZONE_BEGIN("scheduler_wait");
+    scheduler_wait(scheduler);
+    PROFILE_ZONE_END("scheduler_wait");
 
-    graphics_present(window);
-    graphics_delay(60);
+    PROFILE_FRAME();
   }
 
+  scheduler_free(scheduler);
+  pipeline_free(pipeline);
+
+  // Only once the producer has stopped writing to its profile ring
+#ifdef PROFILE
+  const u32 last = profile_frame_index();
+  profile_export_chrome("trace.json", last > TRACE_FRAMES ? last - TRACE_FRAMES : 0, last);
+#endif
+  terrain_free(scene.terrain);
   graphics_close(window);
   
   return 0;
@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "utils.h"
+
+#include "geometry.c"
+#include "arena.c"
+#include "graphics.c"
+#include "model.c"
+#include "profile.c"
+
+// Converts a Wavefront OBJ file into the binary mesh format that
+// model_load_mesh maps in place, optimized with model_optimize unless asked
+// not to:
+//
+//   meshconv input.obj output.mesh [--double-sided] [--no-optimize]
+
+static void meshconv_print(const char* label, const ModelStats stats) {
+  printf(
+    "%-6s %u vertices, %u triangles, ACMR %.3f, %.1f KiB\n",
+    label, stats.s_vertices, stats.s_triangles, stats.acmr, stats.bytes / 1024.0
+  );
+}
+
+i32 main(const i32 argc, const char* argv[]) {
+  bool
+    double_sided = false,
+    optimize     = true,
+    usage        = argc < 3;
+  for (i32 i = 3; i < argc; i++) {
+    if (strcmp(argv[i], "--double-sided") == 0)
+      double_sided = true;
+    else if (strcmp(argv[i], "--no-optimize") == 0)
+      optimize = false;
+    else
+      usage = true;
+  }
+  if (usage) {
+    fprintf(stderr, "usage: %s input.obj output.mesh [--double-sided] [--no-optimize]\n", argv[0]);
+    return 1;
+  }
+
+  Model* model = model_load_obj(argv[1]);
+  if (model == NULL)
+    return 1;
+  model->double_sided = double_sided;
+
+  meshconv_print("input", model_stats(model));
+  if (optimize) {
+    model_optimize(model);
+    meshconv_print("output", model_stats(model));
+  }
+
+  const bool ok = model_save_mesh(model, argv[2]);
+  if (ok)
+    printf("wrote %s\n", argv[2]);
+
+  model_free(model);
+  return ok ? 0 : 1;
+}